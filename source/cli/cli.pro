@@ -0,0 +1,10 @@
+# renders one frame to a file, for batch jobs and benchmarks
+TEMPLATE = app
+CONFIG += console
+CONFIG -= qt app_bundle
+TARGET = mandelbrot_cli
+
+include(../core.pri)
+
+SOURCES += \
+    ../src/cli/main.cpp
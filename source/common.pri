@@ -0,0 +1,28 @@
+# settings shared by the core, the GUI and the command line tool
+
+CONFIG += c++17
+
+# Sanitizers
+#CONFIG += sanitizer
+#CONFIG += sanitize_address
+#CONFIG += sanitize_memory
+#CONFIG += sanitize_thread
+#CONFIG += sanitize_undefined
+
+# use this due to "undefined reference to __atomic_store" and "undefined reference to __atomic_load"
+# only for windows qt
+LIBS += -latomic
+
+# exports are deflated by the system zlib
+LIBS += -lz
+
+# SIMD kernels are compiled with their own target attributes and chosen at startup.
+# set MANDELBROT_KERNEL environment variable to scalar, sse2, avx2 or avx512 to force one.
+
+# Another performance flags
+QMAKE_CXXFLAGS_RELEASE -= -O0
+QMAKE_CXXFLAGS_RELEASE -= -O1
+QMAKE_CXXFLAGS_RELEASE -= -O2
+QMAKE_CXXFLAGS_RELEASE += -O3
+
+INCLUDEPATH += $$PWD/include
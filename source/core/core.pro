@@ -0,0 +1,48 @@
+# kernels, scheduler, caches and frame buffers. no Qt here,
+# so it runs on the render servers and inside the other tools
+TEMPLATE = lib
+CONFIG += staticlib
+CONFIG -= qt
+TARGET = core
+
+include(../common.pri)
+
+SOURCES += \
+    ../src/bigfixed.cpp \
+    ../src/engine.cpp \
+    ../src/exporter.cpp \
+    ../src/frameexchange.cpp \
+    ../src/imagewriter.cpp \
+    ../src/kernels/avx2.cpp \
+    ../src/kernels/avx512.cpp \
+    ../src/kernels/dispatch.cpp \
+    ../src/kernels/scalar.cpp \
+    ../src/kernels/sse2.cpp \
+    ../src/log.cpp \
+    ../src/perturbation.cpp \
+    ../src/tilecache.cpp \
+    ../src/tilescheduler.cpp \
+    ../src/trace.cpp \
+    ../src/workerpool.cpp \
+    ../src/zoomsequence.cpp
+
+HEADERS += \
+    ../include/bigfixed.h \
+    ../include/doubledouble.h \
+    ../include/engine.h \
+    ../include/exporter.h \
+    ../include/escape.h \
+    ../include/floatexp.h \
+    ../include/frameexchange.h \
+    ../include/image.h \
+    ../include/imagewriter.h \
+    ../include/kernellanes.h \
+    ../include/kernels.h \
+    ../include/log.h \
+    ../include/mandelbrot.h \
+    ../include/perturbation.h \
+    ../include/tilecache.h \
+    ../include/tilescheduler.h \
+    ../include/trace.h \
+    ../include/workerpool.h \
+    ../include/zoomsequence.h
@@ -0,0 +1,39 @@
+QT       += core gui
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+TARGET = mandelbrot_set
+
+# You can make your code fail to compile if it uses deprecated APIs.
+# In order to do so, uncomment the following line.
+#DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
+
+include(../core.pri)
+
+INCLUDEPATH += \
+    ../include/widgets \
+    ../include/windows
+
+SOURCES += \
+    ../src/main.cpp \
+    ../src/renderer.cpp \
+    ../src/windows/mainwindow.cpp \
+    ../src/windows/parametersdialog.cpp \
+    ../src/widgets/statusbar.cpp \
+    ../src/widgets/viewport.cpp
+
+HEADERS += \
+    ../include/renderer.h \
+    ../include/windows/mainwindow.h \
+    ../include/windows/parametersdialog.h \
+    ../include/widgets/statusbar.h \
+    ../include/widgets/viewport.h
+
+FORMS += \
+    ../forms/mainwindow.ui \
+    ../forms/parametersdialog.ui
+
+# Default rules for deployment.
+qnx: target.path = /tmp/$${TARGET}/bin
+else: unix:!android: target.path = /opt/$${TARGET}/bin
+!isEmpty(target.path): INSTALLS += target
@@ -0,0 +1,64 @@
+#ifndef BIGFIXED_H
+#define BIGFIXED_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <floatexp.h>
+
+namespace mandelbrot {
+
+/*
+ * Signed fixed point number of arbitrary precision.
+ * It has 32-bit integer part and any count of 32-bit fraction limbs,
+ * which is enough for the plane coordinates and the reference orbits,
+ * because they never leave small neighbourhood of zero.
+ *
+ * Arithmetic of numbers with different precision gives the greater one.
+ */
+class BigFixed {
+public:
+    BigFixed() = default;
+    BigFixed(double, size_t = 2);
+    BigFixed(FloatExp, size_t);
+
+    // count of fraction limbs, which is enough to address pixels of that size
+    static size_t limbsFor(FloatExp scale);
+    // decimal like -1.25, exact up to the precision. false if it is not a number
+    static bool parse(std::string const&, size_t, BigFixed&);
+
+    size_t precision() const;
+    void setPrecision(size_t);
+
+    double toDouble() const;
+    FloatExp toFloatExp() const;
+    std::string toString(size_t digits) const;
+
+    BigFixed operator-() const;
+    BigFixed operator+(BigFixed const&) const;
+    BigFixed operator-(BigFixed const&) const;
+    BigFixed operator*(BigFixed const&) const;
+
+    BigFixed& operator+=(BigFixed const&);
+    BigFixed& operator-=(BigFixed const&);
+    BigFixed& operator*=(BigFixed const&);
+
+    bool operator<(BigFixed const&) const;
+    bool operator==(BigFixed const&) const;
+    bool operator!=(BigFixed const&) const;
+
+private:
+    static int compareMagnitude(BigFixed const&, BigFixed const&);
+    static BigFixed addMagnitude(BigFixed const&, BigFixed const&, bool negative);
+    static BigFixed subMagnitude(BigFixed const&, BigFixed const&, bool negative);
+    void setBits(uint64_t, int64_t);
+    bool isZero() const;
+
+    bool negative = false;
+    // limbs[0] is integer part, the rest are fraction from the most significant one
+    std::vector<uint32_t> limbs = std::vector<uint32_t>(3, 0);
+};
+
+}
+
+#endif // BIGFIXED_H
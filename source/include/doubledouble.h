@@ -0,0 +1,70 @@
+#ifndef DOUBLEDOUBLE_H
+#define DOUBLEDOUBLE_H
+
+#include <cmath>
+
+namespace mandelbrot {
+
+/*
+ * Unevaluated sum hi + lo of two doubles, about 106 bits of mantissa.
+ * Built on error-free transforms, products need FMA to be fast.
+ * Additions are the "sloppy" ones: cancellation may cost some of the low bits,
+ * which doesn't matter for escape steps.
+ */
+struct DoubleDouble {
+    double hi = 0;
+    double lo = 0;
+
+    DoubleDouble() = default;
+    DoubleDouble(double hi, double lo = 0) : hi(hi), lo(lo) {}
+
+    // a + b = s + e exactly
+    static DoubleDouble twoSum(double a, double b) {
+        double s = a + b;
+        double bb = s - a;
+        return {s, (a - (s - bb)) + (b - bb)};
+    }
+
+    // the same, but |a| >= |b| is required
+    static DoubleDouble quickTwoSum(double a, double b) {
+        double s = a + b;
+        return {s, b - (s - a)};
+    }
+
+    // a * b = p + e exactly
+    static DoubleDouble twoProd(double a, double b) {
+        double p = a * b;
+        return {p, std::fma(a, b, -p)};
+    }
+
+    DoubleDouble operator-() const {
+        return {-hi, -lo};
+    }
+
+    DoubleDouble operator+(DoubleDouble const& other) const {
+        DoubleDouble s = twoSum(hi, other.hi);
+        return quickTwoSum(s.hi, s.lo + lo + other.lo);
+    }
+
+    DoubleDouble operator-(DoubleDouble const& other) const {
+        return *this + (-other);
+    }
+
+    DoubleDouble operator*(DoubleDouble const& other) const {
+        DoubleDouble p = twoProd(hi, other.hi);
+        return quickTwoSum(p.hi, p.lo + (hi * other.lo + lo * other.hi));
+    }
+
+    DoubleDouble sqr() const {
+        DoubleDouble p = twoProd(hi, hi);
+        return quickTwoSum(p.hi, p.lo + 2 * hi * lo);
+    }
+
+    double toDouble() const {
+        return hi + lo;
+    }
+};
+
+}
+
+#endif // DOUBLEDOUBLE_H
@@ -0,0 +1,183 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <mandelbrot.h>
+#include <image.h>
+#include <workerpool.h>
+#include <tilescheduler.h>
+#include <tilecache.h>
+#include <frameexchange.h>
+#include <kernels.h>
+#include <perturbation.h>
+#include <doubledouble.h>
+
+namespace mandelbrot {
+
+enum Coloring {
+    LINEAR, // steps onto the red channel
+    SMOOTH, // normalized iteration count through the cyclic gradient
+    HISTOGRAM // the same, but equalized by the frame histogram
+};
+
+struct RendererSettings {
+    size_t threadsCount = MAX_THREADS_COUNT;
+    size_t iterationsCount;
+    bool threadsCountAuto = true;
+    bool iterationsCountAuto = true;
+    bool subdivision = false; // Mariani-Silver: skip tiles with uniform border
+    size_t tileCacheMegabytes = DEFAULT_TILE_CACHE_MEGABYTES;
+    Coloring coloring = LINEAR;
+    bool progressive = true; // the coarse stages and the overview go first
+    ThreadPriority priority = ThreadPriority::NORMAL; // of the engine thread and its workers
+    size_t tileSize = TILE_SIZE; // of the scheduled tiles, for the benchmarks
+    bool iterationsCountAdaptive = true; // the automatic count is corrected by the frames rendered
+};
+
+struct WorkerSettings : RendererSettings {
+    WorkerSettings() = default;
+    WorkerSettings(RendererSettings const& rs) : RendererSettings(rs) {}
+
+    size_t frameSeqId;
+    Size originalSize;
+    Size size;
+    Pos offset;
+    BigPos center; // exact offset, for the reference orbit
+    DoubleDouble offsetX, offsetY; // offset for the double-double kernels
+    double scale;
+    FloatExp preciseScale; // scale may underflow double
+    double scaleLog;
+    bool lowResolutionOnly;
+    double EPS;
+    kernels::Precision precision;
+    bool perturbation;
+    std::chrono::steady_clock::time_point requestTime;
+};
+
+/*
+ * Renders the requested frames on its own thread, stage by stage, and publishes them to the exchanges.
+ * A new request drops the frame being rendered. It has nothing to do with Qt, so the GUI, the command line
+ * tool and anything else are its clients.
+ */
+class Engine {
+public:
+    Engine();
+
+    // called on the render thread, when something is published since the last take
+    void setFrameCallback(std::function<void()>);
+
+    void request(size_t, BigPos const&, Size, FloatExp, double, bool);
+    void stop();
+    void wait();
+
+    RendererSettings getSettings() const;
+    void setSettings(RendererSettings);
+    size_t iterationsCountAuto(size_t) const;
+    size_t iterationsCountAdapted(size_t) const;
+    size_t threadsCountAuto() const;
+
+    // clients take the delivered frames from here, the overviews are downscaled
+    FrameExchange& frames(bool);
+
+    ~Engine();
+
+private:
+    // worker gets its index for the per-worker data
+    using Worker = void(Engine::*)(Tile const&, size_t);
+
+    void run();
+
+    // helpers
+    void runStage(size_t);
+    void runWorkers(Worker, bool, bool);
+    void runPass(Worker);
+    void buildPalette();
+    void clearHistograms();
+    void equalize();
+    Rgb color(Escape const&) const;
+    Rgb colorSmooth(Escape const&) const;
+    Rgb colorEqualized(Escape const&) const;
+    void colorize(Tile const&, size_t, size_t);
+    void finishTile(Tile const&, size_t, size_t);
+    void approxSteps(double*, double*, size_t, kernels::Precision, Escape*);
+    bool computePixels(size_t const*, size_t);
+    void countSamples(Escape const*, size_t);
+    bool subdivide(Tile const&, size_t&);
+    size_t reuseIterations(bool);
+    bool adaptIterations();
+    int iterationsShiftAt(size_t) const;
+    void moveCenter(BigPos const&);
+    bool moveToCacheGrid();
+    size_t loadCachedTiles(bool);
+
+    // workers
+    void workerImprecise(Tile const&, size_t);
+    void workerPrecise(Tile const&, size_t);
+    void workerSubdivision(Tile const&, size_t);
+    void workerColorize(Tile const&, size_t);
+
+    std::atomic<RendererSettings> settings;
+    WorkerSettings requested; // guarded by mutex
+    WorkerSettings current;
+    perturbation::Orbit orbit;
+
+    // external control
+    std::thread thread;
+    std::atomic_bool running = false;
+    std::function<void()> frameCallback;
+    std::atomic_bool dropFrame = false;
+    std::atomic_bool shutdown = false;
+    // of the automatic iterations count, in octaves, learned by the frames around that scaleLog
+    struct IterationsShift {
+        int octaves;
+        int scaleLog;
+    };
+    std::atomic<IterationsShift> iterationsShift = IterationsShift{0, 0};
+
+    // stats
+    std::atomic<size_t> skippedPixels = 0;
+    std::atomic<uint64_t> iteratedSteps = 0;
+    std::atomic<uint64_t> escapedSamples = 0;
+    std::atomic<uint64_t> convergedSamples = 0;
+    std::atomic<uint64_t> cappedSamples = 0;
+    FrameStats frameStats; // the counters are added at the delivery
+
+    // something necessary
+    mutable std::mutex mutex;
+    std::condition_variable cv;
+
+    // images being rendered, they are exchanged for free ones on delivery
+    Image buffer;
+    Image overview;
+    FrameExchange preciseFrames;
+    FrameExchange overviewFrames;
+    int64_t overviewOriginX = 0; // precise frame position in the overview, aligned to the blocks
+    int64_t overviewOriginY = 0;
+    size_t stageBlockSize = 1;
+
+    // raw escape data of the precise frame pixels, kept for the next frame
+    std::vector<Escape> iterations;
+    std::vector<Escape> shiftedIterations;
+    std::vector<Rgb> palette; // color of every steps count
+    std::vector<Rgb> gradient;
+    std::vector<float> levels; // gradient position of every steps count, when equalized
+    std::vector<std::vector<uint32_t>> histograms; // of the exterior steps, per worker
+    std::vector<uint32_t> histogramTops; // the largest exterior steps counted by every worker, the bins above are zero
+    std::vector<uint64_t> histogramTotal; // the merged one, up to the largest top
+    WorkerSettings iterationsFrame;
+    Pos frameOffset; // frame center is moved onto the previous pixel grid
+    TileCache tileCache;
+    int64_t cacheGridX = 0; // frame top left pixel on the tile cache grid
+    int64_t cacheGridY = 0;
+    WorkerPool pool;
+    TileScheduler scheduler;
+};
+
+}
+
+#endif // ENGINE_H
@@ -0,0 +1,74 @@
+#ifndef ESCAPE_H
+#define ESCAPE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace mandelbrot {
+
+// pixels which are not computed yet
+const inline uint32_t UNKNOWN_STEPS = std::numeric_limits<uint32_t>::max();
+
+/*
+ * Raw result of iterating a point. Colors are made of it by a separate pass,
+ * so the palette can change without iterating anything again.
+ * Escaped points have |z|^2 >= 4, hence zero norm marks the interior ones which reached the limit,
+ * and negative one the ones which converged earlier, minus the steps they took.
+ */
+struct Escape {
+    uint32_t steps = UNKNOWN_STEPS;
+    float norm = 0; // |z|^2 right after the escape, for smooth coloring
+
+    static Escape outside(size_t steps, double norm) {
+        return {static_cast<uint32_t>(steps), static_cast<float>(norm)};
+    }
+
+    // reached the limit
+    static Escape inside(size_t iterationsCount) {
+        return {static_cast<uint32_t>(iterationsCount), 0};
+    }
+
+    // found by the periodicity check after the steps, it is colored as the limit is
+    static Escape converged(size_t iterationsCount, size_t steps) {
+        return {static_cast<uint32_t>(iterationsCount), -static_cast<float>(steps)};
+    }
+
+    bool known() const {
+        return steps != UNKNOWN_STEPS;
+    }
+
+    bool interior() const {
+        return norm <= 0;
+    }
+
+    bool periodic() const {
+        return norm < 0;
+    }
+
+    // iterations actually done for the point
+    size_t iterated() const {
+        return periodic() ? static_cast<size_t>(-norm) : steps;
+    }
+
+    // the same point under another limit: what escaped or converged before both limits stays,
+    // the rest reaches the lower one. unknown, when the raised limit has to be iterated to
+    Escape relimited(size_t from, size_t to) const {
+        if (!known() || from == to) {
+            return *this;
+        }
+        if (iterated() < (from < to ? from : to)) {
+            return interior() ? converged(to, iterated()) : *this;
+        }
+        return to < from ? inside(to) : Escape();
+    }
+
+    // the same color whatever palette is, unless it is smooth
+    bool sameSteps(Escape const& other) const {
+        return steps == other.steps && interior() == other.interior();
+    }
+};
+
+}
+
+#endif // ESCAPE_H
@@ -0,0 +1,68 @@
+#ifndef EXPORTER_H
+#define EXPORTER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <mandelbrot.h>
+#include <engine.h>
+#include <imagewriter.h>
+
+namespace mandelbrot {
+
+/*
+ * Renders images of any size into files, band by band. Every band is a complete frame
+ * of its own engine and goes to the streaming writer, which compresses it while the next
+ * band is rendered, so only a few bands are in memory. The export runs on its own thread
+ * at the background priority, the interactive engine is not disturbed.
+ *
+ * Histogram coloring is equalized per frame, so it is kept only when the image is a single band,
+ * otherwise the bands are colored smoothly, or they would differ.
+ */
+class Exporter {
+public:
+    static const int MAX_SIZE = 1 << 18;
+
+    // rows written and all of them, called on the export thread
+    using Progress = std::function<void(size_t, size_t)>;
+    // error message, empty if the file is written, called on the export thread at the end
+    using Finished = std::function<void(std::string const&)>;
+
+    void setProgressCallback(Progress);
+    void setFinishedCallback(Finished);
+
+    // false if the format is unknown or an export is running already
+    bool start(std::string const&, BigPos const&, Size, FloatExp, double, RendererSettings);
+    bool busy() const;
+    void cancel();
+    void wait();
+
+    ~Exporter();
+
+private:
+    void run();
+
+    // external control
+    std::thread thread;
+    std::atomic_bool running = false;
+    std::atomic_bool cancelled = false;
+    Progress progressCallback;
+    Finished finishedCallback;
+
+    // the export being written
+    std::string fileName;
+    BigPos center;
+    Size size;
+    FloatExp scale;
+    double scaleLog = 0;
+    RendererSettings settings;
+    std::unique_ptr<ImageWriter> writer; // taken by the export thread
+};
+
+}
+
+#endif // EXPORTER_H
@@ -0,0 +1,125 @@
+#ifndef FLOATEXP_H
+#define FLOATEXP_H
+
+#include <cmath>
+#include <cstdint>
+
+namespace mandelbrot {
+
+/*
+ * Double with extended exponent: mantissa * 2^exponent.
+ * Keeps pixel sizes and perturbation deltas far below 1e-308.
+ */
+struct FloatExp {
+    double mantissa = 0; // 0.5 <= |mantissa| < 1, or zero
+    int64_t exponent = 0;
+
+    FloatExp() = default;
+
+    FloatExp(double value) {
+        int e;
+        mantissa = std::frexp(value, &e);
+        exponent = e;
+    }
+
+    FloatExp(double m, int64_t e) {
+        int d;
+        mantissa = std::frexp(m, &d);
+        exponent = (mantissa == 0) ? 0 : e + d;
+    }
+
+    // tiny values become zero, huge ones become infinity
+    double toDouble() const {
+        if (exponent < -1100) {
+            return 0;
+        }
+        if (exponent > 1100) {
+            return std::copysign(INFINITY, mantissa);
+        }
+        return std::ldexp(mantissa, static_cast<int>(exponent));
+    }
+
+    // approximate, but good enough for choosing precision
+    double log2() const {
+        return exponent + std::log2(std::abs(mantissa));
+    }
+
+    bool isZero() const {
+        return mantissa == 0;
+    }
+
+    FloatExp abs() const {
+        FloatExp res = *this;
+        res.mantissa = std::abs(mantissa);
+        return res;
+    }
+
+    FloatExp operator-() const {
+        FloatExp res = *this;
+        res.mantissa = -mantissa;
+        return res;
+    }
+
+    FloatExp operator*(FloatExp const& other) const {
+        return {mantissa * other.mantissa, exponent + other.exponent};
+    }
+
+    FloatExp& operator*=(FloatExp const& other) {
+        return *this = *this * other;
+    }
+
+    FloatExp operator/(FloatExp const& other) const {
+        return {mantissa / other.mantissa, exponent - other.exponent};
+    }
+
+    FloatExp& operator/=(FloatExp const& other) {
+        return *this = *this / other;
+    }
+
+    FloatExp operator+(FloatExp const& other) const {
+        if (other.mantissa == 0) {
+            return *this;
+        }
+        if (mantissa == 0 || exponent < other.exponent) {
+            return (mantissa == 0) ? other : other + *this;
+        }
+
+        int64_t diff = exponent - other.exponent;
+        if (diff > 64) {
+            return *this; // the other one is lost in rounding anyway
+        }
+        return {mantissa + std::ldexp(other.mantissa, static_cast<int>(-diff)), exponent};
+    }
+
+    FloatExp& operator+=(FloatExp const& other) {
+        return *this = *this + other;
+    }
+
+    FloatExp operator-(FloatExp const& other) const {
+        return *this + (-other);
+    }
+
+    FloatExp& operator-=(FloatExp const& other) {
+        return *this = *this - other;
+    }
+
+    bool operator<(FloatExp const& other) const {
+        return (*this - other).mantissa < 0;
+    }
+
+    bool operator>(FloatExp const& other) const {
+        return other < *this;
+    }
+
+    bool operator==(FloatExp const& other) const {
+        return mantissa == other.mantissa && exponent == other.exponent;
+    }
+
+    bool operator!=(FloatExp const& other) const {
+        return !(operator==(other));
+    }
+};
+
+}
+
+#endif // FLOATEXP_H
@@ -0,0 +1,84 @@
+#ifndef FRAMEEXCHANGE_H
+#define FRAMEEXCHANGE_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mandelbrot.h>
+#include <image.h>
+
+namespace mandelbrot {
+
+// what the frame took so far, every stage adds to it. samples of the overview are counted too.
+// it is copied to the exchange with every stage, so there is nothing on the heap
+struct FrameStats {
+    static constexpr size_t MAX_WORKERS = 256; // the busy times of the others are not kept
+    static constexpr size_t MAX_PASSES = 8; // the overview and the stages
+
+    struct Pass {
+        char const* name; // a literal
+        double ms;
+    };
+
+    uint64_t iterations = 0; // actually done, the interior points stopped by the periodicity check save them
+    uint64_t escaped = 0;
+    uint64_t converged = 0; // found interior by the periodicity check
+    uint64_t capped = 0; // reached the iterations limit
+    uint64_t reused = 0; // pixels of the previous frame and of the tile cache
+    uint64_t skipped = 0; // pixels filled by the subdivision without iterating them
+    std::array<double, MAX_WORKERS> busyMs = {}; // per worker, of all the passes
+    size_t workersCount = 0;
+    std::array<Pass, MAX_PASSES> passes = {};
+    size_t passesCount = 0;
+    double elapsedMs = 0; // since the request
+};
+
+struct FrameInfo {
+    size_t frameSeqId = 0;
+    Pos offset; // of the frame center from the requested one, in pixels
+    bool complete = false;
+    FrameStats stats;
+};
+
+/*
+ * Triple buffer between Renderer and Viewport, one for the precise frames and one for the overviews.
+ * Renderer draws into its own image and publishes it, which hands over the image and gives back
+ * a free one. Viewport takes the latest published image and keeps it until the next take.
+ * Nobody waits for anybody: a published image which is not taken yet is replaced by the newer one.
+ * Images are only swapped, so they are allocated once per frame size.
+ *
+ * publish is meant to be called by the renderer thread only, take and the getters by the viewport one.
+ */
+class FrameExchange {
+public:
+    // info of the image to be published, filled in place by the writer
+    FrameInfo& next();
+
+    // image is exchanged for a free one, which has no defined pixels (or size).
+    // returns true if the reader has to be notified, i. e. it is not notified since the last take
+    bool publish(Image&);
+
+    // returns false if nothing is published since the last take
+    bool take();
+    Image const& image() const;
+    FrameInfo const& info() const;
+
+private:
+    struct Slot {
+        Image image;
+        FrameInfo info;
+    };
+
+    static const uint32_t INDEX_MASK = 3;
+    static const uint32_t FRESH = 4; // the middle slot is published, but not taken yet
+
+    std::array<Slot, 3> ring;
+    uint32_t back = 0; // the slot which image is lent to the writer
+    uint32_t front = 1;
+    std::atomic<uint32_t> middle = 2;
+    std::atomic_bool notified = false;
+};
+
+}
+
+#endif // FRAMEEXCHANGE_H
@@ -0,0 +1,79 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <mandelbrot.h>
+
+namespace mandelbrot {
+
+// 0xffRRGGBB, as QRgb of QImage::Format_RGB32
+using Rgb = uint32_t;
+
+constexpr Rgb rgb(uint32_t r, uint32_t g, uint32_t b) {
+    return 0xff000000u | (r & 0xff) << 16 | (g & 0xff) << 8 | (b & 0xff);
+}
+
+constexpr uint32_t red(Rgb color) {
+    return (color >> 16) & 0xff;
+}
+
+constexpr uint32_t green(Rgb color) {
+    return (color >> 8) & 0xff;
+}
+
+constexpr uint32_t blue(Rgb color) {
+    return color & 0xff;
+}
+
+/*
+ * Frame pixels, row by row without padding. The layout is the one of QImage::Format_RGB32,
+ * so the viewport shows them without conversion, and the exporters write them as they are.
+ */
+class Image {
+public:
+    Image() = default;
+    explicit Image(Size size) : imageSize(size), pixels(static_cast<size_t>(size.width()) * size.height()) {}
+
+    Size size() const {
+        return imageSize;
+    }
+
+    int width() const {
+        return imageSize.width();
+    }
+
+    int height() const {
+        return imageSize.height();
+    }
+
+    bool isNull() const {
+        return pixels.empty();
+    }
+
+    Rgb* bits() {
+        return pixels.data();
+    }
+
+    Rgb const* bits() const {
+        return pixels.data();
+    }
+
+    Rgb const* scanLine(int y) const {
+        return pixels.data() + static_cast<size_t>(y) * imageSize.width();
+    }
+
+    void swap(Image& other) {
+        std::swap(imageSize, other.imageSize);
+        pixels.swap(other.pixels);
+    }
+
+private:
+    Size imageSize;
+    std::vector<Rgb> pixels;
+};
+
+}
+
+#endif // IMAGE_H
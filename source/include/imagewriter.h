@@ -0,0 +1,38 @@
+#ifndef IMAGEWRITER_H
+#define IMAGEWRITER_H
+
+#include <memory>
+#include <string>
+#include <mandelbrot.h>
+#include <image.h>
+#include <workerpool.h>
+
+namespace mandelbrot {
+
+/*
+ * Streaming encoder: the image comes in bands, top to bottom, and every band is written
+ * as soon as it is encoded, so the whole image is never in memory. Bands are cut into
+ * strips which are compressed independently on the given pool and written in order.
+ *
+ * PNG strips are raw deflate blocks of one zlib stream, joined as pigz does it.
+ * TIFF strips are its own strips, BigTIFF is chosen when the file may outgrow 4 GB.
+ */
+class ImageWriter {
+public:
+    // rows compressed as a whole, bands should be made of them
+    static const int STRIP_HEIGHT = 16;
+
+    // chosen by the file extension: png, tif, tiff or ppm. nullptr for the unknown ones
+    static std::unique_ptr<ImageWriter> create(std::string const&);
+
+    // all the functions return false on the file errors, errno tells the reason
+    virtual bool open(std::string const&, Size) = 0;
+    virtual bool write(Image const&, WorkerPool&) = 0;
+    virtual bool close() = 0;
+
+    virtual ~ImageWriter() = default;
+};
+
+}
+
+#endif // IMAGEWRITER_H
@@ -0,0 +1,215 @@
+#ifndef KERNELLANES_H
+#define KERNELLANES_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <escape.h>
+
+namespace mandelbrot::kernels {
+
+/*
+ * Scalar side of the SIMD kernels: the lanes state is spilled here
+ * only when some of the lanes have to be replaced by the next points of the row.
+ * Idle lanes keep z = c = 0 forever and have negative steps.
+ * Points always come in double, single precision kernels round them here.
+ */
+template <typename T, size_t N>
+struct Lanes {
+    alignas(64) T c_r[N];
+    alignas(64) T c_i[N];
+    alignas(64) T z_r[N];
+    alignas(64) T z_i[N];
+    alignas(64) T z_r_old[N];
+    alignas(64) T z_i_old[N];
+    alignas(64) T steps[N];
+    size_t pixel[N];
+
+    double const* points_r;
+    double const* points_i;
+    size_t count;
+    size_t next = 0;
+    size_t active = 0;
+
+    Lanes(double const* c_r, double const* c_i, size_t count)
+        : points_r(c_r), points_i(c_i), count(count) {
+        for (size_t lane = 0; lane < N; ++lane) {
+            refill(lane);
+        }
+    }
+
+    void refill(size_t lane) {
+        z_r[lane] = 0;
+        z_i[lane] = 0;
+        z_r_old[lane] = 0;
+        z_i_old[lane] = 0;
+
+        if (next < count) {
+            pixel[lane] = next;
+            c_r[lane] = static_cast<T>(points_r[next]);
+            c_i[lane] = static_cast<T>(points_i[next]);
+            steps[lane] = 0;
+            ++next;
+            ++active;
+        } else {
+            c_r[lane] = 0;
+            c_i[lane] = 0;
+            steps[lane] = -INFINITY;
+        }
+    }
+
+    // if not outside, but converges or reached the limit, then inside.
+    // the escape goes first, as the periodicity check may pass at the step of the escape
+    void retire(size_t lane, bool escaped, size_t iterationsCount, Escape* out) {
+        double norm = static_cast<double>(z_r[lane]) * z_r[lane] + static_cast<double>(z_i[lane]) * z_i[lane];
+        out[pixel[lane]] = escaped ? Escape::outside(steps[lane], norm)
+                : steps[lane] < iterationsCount ? Escape::converged(iterationsCount, steps[lane])
+                : Escape::inside(iterationsCount);
+        --active;
+        refill(lane);
+    }
+};
+
+/*
+ * Lanes of the double-double kernels, every value is split into hi and lo arrays.
+ */
+template <size_t N>
+struct DoubleDoubleLanes {
+    alignas(64) double c_r[N];
+    alignas(64) double c_r_lo[N];
+    alignas(64) double c_i[N];
+    alignas(64) double c_i_lo[N];
+    alignas(64) double z_r[N];
+    alignas(64) double z_r_lo[N];
+    alignas(64) double z_i[N];
+    alignas(64) double z_i_lo[N];
+    alignas(64) double z_r_old[N];
+    alignas(64) double z_r_old_lo[N];
+    alignas(64) double z_i_old[N];
+    alignas(64) double z_i_old_lo[N];
+    alignas(64) double steps[N];
+    size_t pixel[N];
+
+    double const* points_r;
+    double const* points_r_lo;
+    double const* points_i;
+    double const* points_i_lo;
+    size_t count;
+    size_t next = 0;
+    size_t active = 0;
+
+    DoubleDoubleLanes(double const* c_r, double const* c_r_lo,
+                      double const* c_i, double const* c_i_lo, size_t count)
+        : points_r(c_r), points_r_lo(c_r_lo), points_i(c_i), points_i_lo(c_i_lo), count(count) {
+        for (size_t lane = 0; lane < N; ++lane) {
+            refill(lane);
+        }
+    }
+
+    void refill(size_t lane) {
+        z_r[lane] = z_r_lo[lane] = 0;
+        z_i[lane] = z_i_lo[lane] = 0;
+        z_r_old[lane] = z_r_old_lo[lane] = 0;
+        z_i_old[lane] = z_i_old_lo[lane] = 0;
+
+        if (next < count) {
+            pixel[lane] = next;
+            c_r[lane] = points_r[next];
+            c_r_lo[lane] = points_r_lo[next];
+            c_i[lane] = points_i[next];
+            c_i_lo[lane] = points_i_lo[next];
+            steps[lane] = 0;
+            ++next;
+            ++active;
+        } else {
+            c_r[lane] = c_r_lo[lane] = 0;
+            c_i[lane] = c_i_lo[lane] = 0;
+            steps[lane] = -INFINITY;
+        }
+    }
+
+    // lo parts don't matter for the norm, the escape goes first as well
+    void retire(size_t lane, bool escaped, size_t iterationsCount, Escape* out) {
+        double norm = z_r[lane] * z_r[lane] + z_i[lane] * z_i[lane];
+        out[pixel[lane]] = escaped ? Escape::outside(steps[lane], norm)
+                : steps[lane] < iterationsCount ? Escape::converged(iterationsCount, steps[lane])
+                : Escape::inside(iterationsCount);
+        --active;
+        refill(lane);
+    }
+};
+
+/*
+ * Lanes of the perturbation kernels: deltas from the reference orbit and the index of its point.
+ * Snapshots of the periodicity check are kept by the parts, Z and dz, and taken at the powers
+ * of two steps of every lane. Idle lanes keep dz = dc = 0 and the index at the start of the orbit.
+ */
+template <size_t N>
+struct PerturbationLanes {
+    alignas(64) double dc_r[N];
+    alignas(64) double dc_i[N];
+    alignas(64) double dz_r[N];
+    alignas(64) double dz_i[N];
+    alignas(64) double z_r[N]; // Z + dz, for the norm of the retired ones
+    alignas(64) double z_i[N];
+    alignas(64) double Z_r_old[N];
+    alignas(64) double Z_i_old[N];
+    alignas(64) double dz_r_old[N];
+    alignas(64) double dz_i_old[N];
+    alignas(64) double steps[N];
+    alignas(64) double snapshot[N]; // steps of the next snapshot
+    alignas(64) int64_t m[N];
+    size_t pixel[N];
+
+    double const* points_r;
+    double const* points_i;
+    size_t count;
+    size_t next = 0;
+    size_t active = 0;
+
+    PerturbationLanes(double const* dc_r, double const* dc_i, size_t count)
+        : points_r(dc_r), points_i(dc_i), count(count) {
+        for (size_t lane = 0; lane < N; ++lane) {
+            refill(lane);
+        }
+    }
+
+    // no snapshot is close to anything until the first one is taken
+    void refill(size_t lane) {
+        dz_r[lane] = 0;
+        dz_i[lane] = 0;
+        Z_r_old[lane] = INFINITY;
+        Z_i_old[lane] = INFINITY;
+        dz_r_old[lane] = 0;
+        dz_i_old[lane] = 0;
+        snapshot[lane] = 1;
+        m[lane] = 0;
+
+        if (next < count) {
+            pixel[lane] = next;
+            dc_r[lane] = points_r[next];
+            dc_i[lane] = points_i[next];
+            steps[lane] = 0;
+            ++next;
+            ++active;
+        } else {
+            dc_r[lane] = 0;
+            dc_i[lane] = 0;
+            steps[lane] = -INFINITY;
+        }
+    }
+
+    // the same as Lanes::retire
+    void retire(size_t lane, bool escaped, size_t iterationsCount, Escape* out) {
+        double norm = z_r[lane] * z_r[lane] + z_i[lane] * z_i[lane];
+        out[pixel[lane]] = escaped ? Escape::outside(steps[lane], norm)
+                : steps[lane] < iterationsCount ? Escape::converged(iterationsCount, steps[lane])
+                : Escape::inside(iterationsCount);
+        --active;
+        refill(lane);
+    }
+};
+
+}
+
+#endif // KERNELLANES_H
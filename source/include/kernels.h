@@ -0,0 +1,103 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <cstddef>
+#include <vector>
+#include <escape.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define MANDELBROT_X86 1
+#endif
+
+// lets functions use instruction sets which are not enabled for the whole build
+#if defined(__GNUC__) || defined(__clang__)
+#define KERNEL_TARGET(isa) __attribute__((target(isa)))
+#else
+#define KERNEL_TARGET(isa)
+#endif
+
+namespace mandelbrot {
+
+// OPTIMIZATION CONSTANTS
+const inline size_t PERIODICITY_CHECK_THRESHOLD = 19;
+
+namespace kernels {
+
+enum Precision {
+    SINGLE, DOUBLE, DOUBLE_DOUBLE
+};
+
+/*
+ * Computes escape steps of every point (c_r[i], c_i[i]), i < count.
+ * Points which don't escape in iterationsCount steps or converge
+ * are inside, with exactly iterationsCount steps.
+ */
+using Function = void(*)(double const* c_r, double const* c_i, size_t count,
+                         size_t iterationsCount, double EPS, Escape* out);
+
+/*
+ * The same for points given in double-double: c_r[i] + c_r_lo[i], c_i[i] + c_i_lo[i].
+ */
+using DoubleDoubleFunction = void(*)(double const* c_r, double const* c_r_lo,
+                                     double const* c_i, double const* c_i_lo, size_t count,
+                                     size_t iterationsCount, double EPS, Escape* out);
+
+/*
+ * Perturbed points C + (dc_r[i], dc_i[i]), i < count, around the reference orbit Z of orbitSize points,
+ * see perturbation.h. The deltas are iterated from zero and rebased onto the start of the orbit
+ * when the point comes closer to zero than to the reference one.
+ */
+using PerturbationFunction = void(*)(double const* Z_r, double const* Z_i, size_t orbitSize,
+                                     double const* dc_r, double const* dc_i, size_t count,
+                                     size_t iterationsCount, double EPS, Escape* out);
+
+struct Kernel {
+    const char* name;
+    Function run;
+    Function runSingle; // twice as many lanes, good enough for shallow zoom
+    DoubleDoubleFunction runDoubleDouble; // several times slower, but goes about 1e15 times deeper
+    PerturbationFunction runPerturbation; // the lanes gather the reference orbit, so no SSE2 one
+    bool (*supported)();
+
+    // double-double points come in another form, so only SINGLE and DOUBLE here
+    Function get(Precision precision) const {
+        return precision == SINGLE ? runSingle : run;
+    }
+};
+
+// all the kernels compiled in, from the most preferable one
+std::vector<Kernel> const& family();
+
+// chosen once at startup, the best one supported by CPU,
+// unless MANDELBROT_KERNEL environment variable forces another one
+Kernel const& active();
+
+Escape approxStepsPower2(double z_r, double z_i, size_t initialSteps,
+                         double c_r, double c_i, size_t iterationsCount, double EPS);
+
+// the perturbed point from the given delta dz and the reference orbit index m
+Escape perturbedSteps(double const* Z_r, double const* Z_i, size_t orbitSize, double dz_r, double dz_i,
+                      double dc_r, double dc_i, size_t initialSteps, size_t m, size_t iterationsCount, double EPS);
+
+void runScalar(double const*, double const*, size_t, size_t, double, Escape*);
+void runScalarSingle(double const*, double const*, size_t, size_t, double, Escape*);
+void runScalarDoubleDouble(double const*, double const*, double const*, double const*, size_t, size_t, double, Escape*);
+void runScalarPerturbation(double const*, double const*, size_t, double const*, double const*, size_t, size_t, double, Escape*);
+#ifdef MANDELBROT_X86
+void runSSE2(double const*, double const*, size_t, size_t, double, Escape*);
+void runSSE2Single(double const*, double const*, size_t, size_t, double, Escape*);
+void runAVX2(double const*, double const*, size_t, size_t, double, Escape*);
+void runAVX2Single(double const*, double const*, size_t, size_t, double, Escape*);
+void runAVX2DoubleDouble(double const*, double const*, double const*, double const*, size_t, size_t, double, Escape*);
+void runAVX2Perturbation(double const*, double const*, size_t, double const*, double const*, size_t, size_t, double, Escape*);
+void runAVX512(double const*, double const*, size_t, size_t, double, Escape*);
+void runAVX512Single(double const*, double const*, size_t, size_t, double, Escape*);
+void runAVX512DoubleDouble(double const*, double const*, double const*, double const*, size_t, size_t, double, Escape*);
+void runAVX512Perturbation(double const*, double const*, size_t, double const*, double const*, size_t, size_t, double, Escape*);
+#endif
+
+}
+
+}
+
+#endif // KERNELS_H
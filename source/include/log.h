@@ -0,0 +1,43 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <functional>
+#include <sstream>
+#include <string>
+
+namespace mandelbrot {
+
+// receives the finished lines, from any thread. nothing is logged until it is set
+using LogHandler = std::function<void(std::string const&)>;
+
+// meant to be called once, before anything is rendered
+void setLogHandler(LogHandler);
+
+/*
+ * Line of the debug log, which goes to the handler when the object dies,
+ * so it is used as a temporary: debug() << "frame " << id << ...
+ */
+class DebugLine {
+public:
+    DebugLine();
+    DebugLine(DebugLine const&) = delete;
+    ~DebugLine();
+
+    template <typename T>
+    DebugLine& operator<<(T const& value) {
+        if (enabled) {
+            stream << value;
+        }
+        return *this;
+    }
+
+private:
+    bool enabled;
+    std::ostringstream stream;
+};
+
+DebugLine debug();
+
+}
+
+#endif // LOG_H
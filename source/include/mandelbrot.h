@@ -1,23 +1,55 @@
 #ifndef MANDELBROT_H
 #define MANDELBROT_H
 
-#include <QPoint>
-#include <QSize>
-#include <QRect>
-#include <QThread>
-
-#ifdef AVX
-#include <immintrin.h>
-#endif
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <thread>
+#include <bigfixed.h>
 
 namespace mandelbrot {
 
+// frame size in pixels, scaling rounds to the nearest like QSize does
+struct Size {
+    int w, h;
+
+    Size() : w(0), h(0) {}
+    Size(int w, int h) : w(w), h(h) {}
+
+    int width() const {
+        return w;
+    }
+
+    int height() const {
+        return h;
+    }
+
+    bool isEmpty() const {
+        return w <= 0 || h <= 0;
+    }
+
+    Size operator*(double c) const {
+        return {static_cast<int>(std::lround(w * c)), static_cast<int>(std::lround(h * c))};
+    }
+
+    Size operator/(double c) const {
+        return {static_cast<int>(std::lround(w / c)), static_cast<int>(std::lround(h / c))};
+    }
+
+    bool operator==(Size const& other) const {
+        return w == other.w && h == other.h;
+    }
+
+    bool operator!=(Size const& other) const {
+        return !(operator==(other));
+    }
+};
+
 struct Pos {
     double x, y;
 
     Pos() : x(0), y(0) {}
-    Pos(QPointF const& p) : x(p.x()), y(p.y()) {}
-    Pos(QSizeF const& p) : x(p.width()), y(p.height()) {}
+    Pos(Size const& s) : x(s.width()), y(s.height()) {}
 
     template <typename T1, typename T2>
     Pos(T1 x, T2 y) : x(x), y(y) {}
@@ -61,11 +93,62 @@ struct Pos {
     bool operator!=(Pos const& other) const {
         return !(operator==(other));
     }
+};
+
+/*
+ * Pos of arbitrary precision, so the viewport center survives deep zooms.
+ * Pixel-sized quantities around it are still plain doubles or FloatExp.
+ */
+struct BigPos {
+    BigFixed x, y;
 
-    Pos fit(QRectF const& other) const {
+    BigPos() = default;
+    BigPos(Pos const& p, size_t precision = 2) : x(p.x, precision), y(p.y, precision) {}
+    BigPos(BigFixed const& x, BigFixed const& y) : x(x), y(y) {}
+
+    BigPos operator+(BigPos const& other) const {
+        return {x + other.x, y + other.y};
+    }
+
+    BigPos& operator+=(BigPos const& other) {
+        return *this = *this + other;
+    }
+
+    BigPos operator-(BigPos const& other) const {
+        return {x - other.x, y - other.y};
+    }
+
+    BigPos& operator-=(BigPos const& other) {
+        return *this = *this - other;
+    }
+
+    bool operator==(BigPos const& other) const {
+        return x == other.x && y == other.y;
+    }
+
+    bool operator!=(BigPos const& other) const {
+        return !(operator==(other));
+    }
+
+    size_t precision() const {
+        return x.precision();
+    }
+
+    void setPrecision(size_t precision) {
+        x.setPrecision(precision);
+        y.setPrecision(precision);
+    }
+
+    Pos toPos() const {
+        return {x.toDouble(), y.toDouble()};
+    }
+
+    // clamps both coordinates by the bounding box
+    BigPos fit(Pos const& min, Pos const& max) const {
+        size_t p = precision();
         return {
-            qBound(other.left(), x, other.right()),
-            qBound(other.bottom(), y, other.top())
+            std::clamp(x, BigFixed(min.x, p), BigFixed(max.x, p)),
+            std::clamp(y, BigFixed(min.y, p), BigFixed(max.y, p))
         };
     }
 };
@@ -73,29 +156,33 @@ struct Pos {
 // WIDGETS CONSTANTS
 const inline double SCALE_STEP = 0.5;
 const inline int WARN_SCALE_LOG = 30; // statusbar stops showing coords properly
-const inline int MAX_SCALE_LOG = 45; // double data type starts distort (?)
+const inline int MAX_SCALE_LOG = 1500; // pixels are about 1e-453 there
 const inline double WARN_RENDER_LATENCY = 2;
 
 const inline double INITIAL_SCALE = 0.005;
 const inline Pos INTIAL_CENTER_OFFSET = {-0.5, 0};
 
-// on win it suprisingly works like f(x0,y0,dx,dy) = {{x0, y0}, {x0 + dx, y0 + dy}}
-// but "height" should be > 0 and it should works like {{x0, y0}, {x0 + dx, y0 - dy}}
-const inline QRectF ALLOWED_COORDS_RECT = {-3, 2, 6, -4};
+// the center can't leave that box
+const inline Pos ALLOWED_COORDS_MIN = {-3, -2};
+const inline Pos ALLOWED_COORDS_MAX = {3, 2};
 
 // RENDERER CONSTANTS
-const inline size_t MAX_THREADS_COUNT = QThread::idealThreadCount();
+const inline size_t MAX_THREADS_COUNT = std::max(1u, std::thread::hardware_concurrency());
 const inline size_t DOWNSCALE_LEVEL = 4;
 const inline size_t MIN_ITERATIONS_BY_PIXEL = 64;
-const inline size_t MAX_ITERATIONS_BY_PIXEL = 2048;
+const inline size_t MAX_ITERATIONS_BY_PIXEL = 1 << 20; // perturbation goes about 30 * MAX_SCALE_LOG deep
 const inline size_t DROPPED_FRAME_CHECK_THRESHOLD = 256;
 const inline size_t DOWNSCALED_IMAGE_SIZE_MULTIPLIER = 4;
-
-// OPTIMIZATION CONSTANTS
-const inline size_t PERIODICITY_CHECK_THRESHOLD = 19;
-#ifdef AVX
-const inline size_t AVX_APPROXIMATION_STEPS = 1024;
-#endif
+const inline size_t TILE_SIZE = 64; // should be divisible by DOWNSCALE_LEVEL
+const inline size_t MIN_TILE_SIZE = 8; // the block of the coarsest stage, scheduled tiles are its multiples
+const inline size_t DEFAULT_TILE_CACHE_MEGABYTES = 128;
+const inline size_t MAX_TILE_CACHE_MEGABYTES = 2048;
+// pixels larger than that are computed in single precision
+const inline double SINGLE_PRECISION_MIN_SCALE = 256 * std::numeric_limits<float>::epsilon();
+// pixels smaller than that are computed in double-double
+const inline double DOUBLE_PRECISION_MIN_SCALE = 256 * std::numeric_limits<double>::epsilon();
+// and pixels smaller than that are computed by perturbation around a reference orbit
+const inline double DOUBLE_DOUBLE_PRECISION_MIN_SCALE = DOUBLE_PRECISION_MIN_SCALE * std::numeric_limits<double>::epsilon();
 
 enum RendererState {
     INITIAL_RENDERING, READY, RENDERING, OFFLINE
@@ -0,0 +1,45 @@
+#ifndef PERTURBATION_H
+#define PERTURBATION_H
+
+#include <vector>
+#include <bigfixed.h>
+#include <floatexp.h>
+#include <escape.h>
+
+namespace mandelbrot::perturbation {
+
+/*
+ * Reference orbit computed in arbitrary precision and rounded to double.
+ * Every pixel is iterated as a small delta from it:
+ *
+ * z[n] = Z[n] + dz[n], c = C + dc
+ * dz[n+1] = (2 * Z[n] + dz[n]) * dz[n] + dc
+ *
+ * Values of Z are bounded by the escape radius, so double keeps them well,
+ * while the deltas are as small as the pixels.
+ */
+struct Orbit {
+    std::vector<double> z_r;
+    std::vector<double> z_i;
+
+    // the orbit is valid for these parameters
+    BigFixed c_r;
+    BigFixed c_i;
+    size_t iterationsCount = 0;
+
+    bool matches(BigFixed const&, BigFixed const&, size_t) const;
+    void compute(BigFixed const&, BigFixed const&, size_t);
+};
+
+/*
+ * Computes escape steps of the points C + (u_r[i], u_i[i]) * scale, i < count,
+ * i.e. u are offsets from the reference point in pixels. They are overwritten by the deltas,
+ * when the deltas are doubles and go to the SIMD kernels.
+ * The pixels which don't escape or converge closer than EPS are inside, with exactly iterationsCount steps.
+ */
+void run(Orbit const&, double* u_r, double* u_i, size_t count,
+         FloatExp scale, size_t iterationsCount, double EPS, Escape* out);
+
+}
+
+#endif // PERTURBATION_H
@@ -0,0 +1,99 @@
+#ifndef TILECACHE_H
+#define TILECACHE_H
+
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+#include <mandelbrot.h>
+#include <escape.h>
+
+namespace mandelbrot {
+
+struct TileCacheStats {
+    size_t lookups = 0;
+    size_t hits = 0;
+    size_t tiles = 0;
+    size_t bytes = 0;
+
+    double hitRate() const {
+        return lookups > 0 ? static_cast<double>(hits) / lookups : 0;
+    }
+};
+
+/*
+ * Steps of the rendered tiles, kept to come back to the recently visited places.
+ * Every zoom level (scale and iterations count) has its own pixel grid, which is
+ * fixed by the top left corner of the first frame rendered on it, so the next
+ * frames have to be moved onto that grid to use the tiles.
+ * Tiles may be partially known. Least recently used ones are evicted to fit the budget.
+ */
+class TileCache {
+public:
+    void setBudget(size_t bytes);
+
+    // grid origin of the level, false if there is no such level yet
+    bool origin(FloatExp scale, size_t iterationsCount, BigPos& origin) const;
+    // (re)starts the level, its old tiles are dropped
+    void setOrigin(FloatExp scale, size_t iterationsCount, BigPos const& origin);
+
+    // frame is given by its top left pixel on the level grid.
+    // load fills unknown pixels by the cached ones and returns count of them,
+    // store merges known pixels into the cache.
+    size_t load(FloatExp scale, size_t iterationsCount, int64_t x, int64_t y,
+                size_t width, size_t height, Escape* pixels);
+    void store(FloatExp scale, size_t iterationsCount, int64_t x, int64_t y,
+               size_t width, size_t height, Escape const* pixels);
+
+    TileCacheStats stats() const;
+
+private:
+    struct Level {
+        FloatExp scale;
+        size_t iterationsCount;
+        BigPos origin;
+        uint64_t id;
+        size_t tiles; // levels without tiles are forgotten
+    };
+
+    struct Key {
+        uint64_t level;
+        int64_t x, y;
+
+        bool operator==(Key const& other) const {
+            return level == other.level && x == other.x && y == other.y;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(Key const& key) const {
+            size_t h = std::hash<uint64_t>()(key.level);
+            h = h * 31 + std::hash<int64_t>()(key.x);
+            return h * 31 + std::hash<int64_t>()(key.y);
+        }
+    };
+
+    struct Entry {
+        Key key;
+        std::vector<Escape> pixels; // TILE_SIZE x TILE_SIZE
+    };
+
+    Level const* find(FloatExp scale, size_t iterationsCount) const;
+    Level* find(uint64_t id);
+    std::vector<Escape>* get(Key const&);
+    void evict();
+
+    static int64_t floorDiv(int64_t, int64_t);
+
+    size_t budget = 0;
+    uint64_t nextLevelId = 0;
+    std::vector<Level> levels;
+    std::list<Entry> entries; // most recently used first
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+    size_t lookups = 0;
+    size_t hits = 0;
+};
+
+}
+
+#endif // TILECACHE_H
@@ -0,0 +1,66 @@
+#ifndef TILESCHEDULER_H
+#define TILESCHEDULER_H
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace mandelbrot {
+
+// half-open rectangle of pixels [x0, x1) x [y0, y1)
+struct Tile {
+    size_t x0, y0;
+    size_t x1, y1;
+};
+
+struct WorkerStats {
+    size_t tiles = 0;
+    size_t stolen = 0;
+    double busyMs = 0;
+    double coloringMs = 0; // part of busyMs
+    double histogramMs = 0; // the same
+};
+
+struct LoadBalanceStats {
+    size_t tiles = 0;
+    size_t stolen = 0;
+    double meanBusyMs = 0;
+    double maxBusyMs = 0;
+    double maxColoringMs = 0;
+    double maxHistogramMs = 0;
+
+    // 1 means that the slowest worker has finished together with the others
+    double imbalance() const {
+        return meanBusyMs > 0 ? maxBusyMs / meanBusyMs : 1;
+    }
+};
+
+/*
+ * Cuts the image into square tiles and deals them out to per-worker deques.
+ * Every worker takes tiles from the front of its own deque, and when it
+ * runs out of them, steals from the back of the others.
+ * Worker stats slots are owned by the workers, read them after all of them finished.
+ */
+class TileScheduler {
+public:
+    void reset(size_t width, size_t height, size_t tileSize, size_t workersCount);
+    bool next(size_t worker, Tile&);
+
+    WorkerStats& workerStats(size_t worker);
+    LoadBalanceStats stats() const;
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Tile> tiles;
+    };
+
+    size_t workersCount = 0;
+    std::unique_ptr<Queue[]> queues;
+    std::vector<WorkerStats> workers;
+};
+
+}
+
+#endif // TILESCHEDULER_H
@@ -0,0 +1,53 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace mandelbrot::trace {
+
+// spans are recorded only between start and stop, otherwise a span costs a relaxed load
+extern std::atomic_bool enabled;
+
+// set MANDELBROT_TRACE environment variable to the file name to trace the whole run
+void start();
+
+// writes the spans recorded since start as Chrome trace JSON, which Perfetto opens too.
+// returns false if the file can't be written
+bool stop(std::string const&);
+
+// shown instead of the number of the thread, may be called before anything is traced
+void setThreadName(std::string const&);
+
+void record(char const*, size_t, int64_t, int64_t);
+
+int64_t now();
+
+/*
+ * Span of the code from the construction to the destruction, tagged with the frame number:
+ * trace::Span span("request", frameSeqId). Names are literals, as only the pointers are kept.
+ * Every thread writes to its own ring, so the oldest spans are lost, when there are too many of them.
+ */
+class Span {
+public:
+    Span(char const* name, size_t frameSeqId)
+        : name(name), frameSeqId(frameSeqId), begin(enabled.load(std::memory_order_relaxed) ? now() : -1) {}
+
+    Span(Span const&) = delete;
+
+    ~Span() {
+        if (begin >= 0) {
+            record(name, frameSeqId, begin, now());
+        }
+    }
+
+private:
+    char const* name;
+    size_t frameSeqId;
+    int64_t begin; // negative when not traced
+};
+
+}
+
+#endif // TRACE_H
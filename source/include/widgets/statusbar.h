@@ -3,8 +3,8 @@
 
 #include <QWidget>
 #include <QLabel>
-#include <QTimer>
 #include <mandelbrot.h>
+#include <frameexchange.h>
 
 class StatusBar : public QWidget
 {
@@ -12,22 +12,18 @@ class StatusBar : public QWidget
 public:
     explicit StatusBar(QWidget *parent = nullptr);
 
-    ~StatusBar();
-
 public slots:
     void updateInfo(mandelbrot::ViewportInfo);
-    void updateTimer();
+    void updateStats(mandelbrot::FrameStats);
 
 private:
+    void findLabels();
+
     QLabel* status = nullptr;
     QLabel* timer = nullptr;
     QLabel* coords = nullptr;
     QLabel* scale = nullptr;
-
-    mandelbrot::RendererState prevRendererState;
-    size_t prevFrameSeqId = 0;
-    QTimer* qtimer;
-    double time;
+    QLabel* stats = nullptr;
 };
 
 #endif // STATUSBAR_H
@@ -5,14 +5,18 @@
 #include <QPixmap>
 #include <QLabel>
 #include <renderer.h>
+#include <exporter.h>
 #include <QPainter>
 
 namespace mandelbrot {
 
 struct Frame {
     QPixmap frame;
+    bool shared = false; // the pixmap is made of the taken image, which the renderer gets back at the next take
     QPointF dragOffset;
+    QPointF gridOffset; // renderer may move the frame center a bit from the requested one
     double scale = 1;
+    double pixelSize = 1; // in the widget pixels, the overview is kept at its sample resolution
 
     QPointF savedDragOffset;
     double savedScale = 1;
@@ -23,8 +27,9 @@ struct Frame {
         savedScale = scale;
     }
 
-    // call after updateFrame
-    void restore() {
+    // call after updateFrame, repeated calls only move the grid
+    void restore(QPointF offset) {
+        gridOffset = offset;
         dragOffset -= savedDragOffset;
         dragOffset *= savedScale;
         scale /= savedScale;
@@ -32,8 +37,17 @@ struct Frame {
         savedScale = 1;
     }
 
-    void setPixmap(QPixmap frame) {
+    void setPixmap(QPixmap frame, bool shared) {
         this->frame = frame;
+        this->shared = shared;
+    }
+
+    // call before the take which may leave the pixmap shown, i. e. before its frame becomes stale
+    void detach() {
+        if (shared) {
+            frame = frame.copy();
+            shared = false;
+        }
     }
 
     void drag(QPointF vec) {
@@ -53,18 +67,22 @@ struct Frame {
     }
 
     void draw(QPainter& p) {
-        auto diff = QSizeF(frame.size() - p.window().size()) / 2.;
-        auto vec = dragOffset - QPointF(diff.width(), diff.height());
+        auto size = QSizeF(frame.size()) * pixelSize;
+        auto diff = (size - QSizeF(p.window().size())) / 2.;
+        auto vec = dragOffset + gridOffset - QPointF(diff.width(), diff.height());
 
+        // painter isn't smooth by default, so the samples are expanded to blocks
         p.save();
         p.scale(scale, scale);
-        p.drawPixmap(vec, frame);
+        p.drawPixmap(QRectF(vec, size), frame, QRectF(frame.rect()));
         p.restore();
     }
 
     void reset() {
         frame = QPixmap();
+        shared = false;
         dragOffset = QPointF();
+        gridOffset = QPointF();
         scale = 1;
         savedDragOffset = QPointF();
         savedScale = 1;
@@ -103,23 +121,28 @@ public:
 
 signals:
     void widgetInfoDelivery(mandelbrot::ViewportInfo);
+    void frameStatsDelivery(mandelbrot::FrameStats);
+
+    // emitted from the export thread, so the connections are queued
+    void exportProgress(int);
+    void exportFinished(QString);
 
 private slots:
-     void updateFrame(QImage, bool, size_t);
+     void updateFrames();
 
 private:
-     void requestFrame();
+     void requestFrame(bool = false);
+     void updateFrame(bool);
      void broadcastWidgetInfo();
 
     // online-render options
-    double scale = mandelbrot::INITIAL_SCALE;
-    mandelbrot::Pos centerOffset = mandelbrot::INTIAL_CENTER_OFFSET;
+    mandelbrot::FloatExp scale = mandelbrot::INITIAL_SCALE;
+    mandelbrot::BigPos centerOffset = mandelbrot::INTIAL_CENTER_OFFSET;
     double scaleLog = 1;
 
     // offline-render options
     mandelbrot::Frame downscaledFrame;
     mandelbrot::Frame detailedFrame;
-    QPixmap delayedFrame;
     QPointF prevDragPos;
 
     // viewport options
@@ -130,6 +153,9 @@ private:
     mandelbrot::RendererState rendererState;
     Renderer renderer;
     size_t frameSeqId = 0;
+
+    // print-size images are rendered beside the interactive frames
+    mandelbrot::Exporter exporter;
 };
 
 #endif // VIEWPORT_H
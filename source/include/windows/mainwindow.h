@@ -29,6 +29,8 @@ private slots: // these slots were automatically added in designer
     void on_about_clicked();
 
     void parameters_closed(int);
+    void export_progress(int);
+    void export_finished(QString);
 
 private:
     Ui::MainWindow *ui;
@@ -23,10 +23,13 @@ public:
 public slots:
     void iterations_slider_update(int);
     void threads_slider_update(int);
+    void cache_slider_update(int);
     void zoom_toggled(int);
     void low_res_toggled(int);
     void threads_auto_toggled(int);
     void iterations_auto_toggled(int);
+    void subdivision_toggled(int);
+    void coloring_changed(int);
 
 private:
     Ui::ParametersDialog *ui;
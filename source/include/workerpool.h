@@ -0,0 +1,65 @@
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mandelbrot {
+
+enum class ThreadPriority {
+    NORMAL,
+    LOW, // the interactive rendering, the GUI thread stays responsive when the workers take all the cores
+    BACKGROUND // the exports, they don't slow down the navigation
+};
+
+/*
+ * Long-living workers owned by Renderer.
+ * Jobs are taken from the shared queue, idle workers sleep on
+ * condition variable, so nobody spins while there is nothing to render.
+ *
+ * resize/submit/wait are meant to be called by the owner thread only.
+ */
+class WorkerPool {
+public:
+    // job receives index of the worker which runs it
+    using Job = std::function<void(size_t)>;
+
+    explicit WorkerPool(size_t = 0);
+
+    void resize(size_t);
+    size_t size() const;
+
+    // workers started after it run at this priority
+    void setPriority(ThreadPriority);
+
+    void submit(Job);
+    void wait();
+
+    ~WorkerPool();
+
+private:
+    void loop(size_t);
+
+    std::vector<std::thread> workers;
+    std::deque<Job> jobs;
+
+    size_t target = 0; // workers with greater or equal index have to leave
+    size_t running = 0; // jobs taken from the queue, but not finished yet
+    bool shutdown = false;
+    ThreadPriority priority = ThreadPriority::NORMAL;
+
+    mutable std::mutex mutex;
+    std::condition_variable jobsCv;
+    std::condition_variable doneCv;
+};
+
+// lowers the priority of the calling thread, there is no way back without privileges
+void setThreadPriority(ThreadPriority);
+
+}
+
+#endif // WORKERPOOL_H
@@ -0,0 +1,38 @@
+#ifndef ZOOMSEQUENCE_H
+#define ZOOMSEQUENCE_H
+
+#include <functional>
+#include <string>
+#include <mandelbrot.h>
+#include <engine.h>
+
+namespace mandelbrot {
+
+/*
+ * Renders a zoom into (or out of) a point as a sequence of frames with exponentially changing scale.
+ * Frames are not rendered one by one: every octave of the zoom has a key frame of twice the size
+ * and half the scale, and the frames within the octave are resampled from it, as all of them
+ * are covered by it with at least one key pixel per frame pixel. Neighbour key frames differ
+ * by exactly two times, so the engine carries a quarter of the samples over from the previous one.
+ *
+ * The output is either a printf-like pattern of the numbered images, like zoom_%05d.png,
+ * or a .rgb (.raw) file of raw RGB24 video. Frames which are in the output already are skipped,
+ * so a stopped run is continued by running it again. Histogram coloring is equalized per key frame.
+ */
+class ZoomSequence {
+public:
+    // frames written and all of them, frames per second so far. called after every frame
+    using Progress = std::function<void(size_t, size_t, double)>;
+
+    void setProgressCallback(Progress);
+
+    // the frames are from the first scale to the second one. returns the error message, empty on success
+    std::string render(std::string const&, BigPos const&, Size, FloatExp, FloatExp, size_t, RendererSettings);
+
+private:
+    Progress progressCallback;
+};
+
+}
+
+#endif // ZOOMSEQUENCE_H
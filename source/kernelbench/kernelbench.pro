@@ -0,0 +1,10 @@
+# speed of the iteration kernels alone, in Miter/s on fixed scenes
+TEMPLATE = app
+CONFIG += console
+CONFIG -= qt app_bundle
+TARGET = mandelbrot_kernelbench
+
+include(../core.pri)
+
+SOURCES += \
+    ../src/kernelbench/main.cpp
@@ -0,0 +1,10 @@
+# latency of the whole frames by the workers count, tile size and frame size
+TEMPLATE = app
+CONFIG += console
+CONFIG -= qt app_bundle
+TARGET = mandelbrot_scalingbench
+
+include(../core.pri)
+
+SOURCES += \
+    ../src/scalingbench/main.cpp
@@ -0,0 +1,257 @@
+#include "bigfixed.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+
+namespace mandelbrot {
+
+BigFixed::BigFixed(double value, size_t fractionLimbs)
+    : negative(value < 0), limbs(fractionLimbs + 1, 0) {
+    int e;
+    double m = std::frexp(std::abs(value), &e);
+    // |m| < 1, so it fits into 64 bits without loss
+    setBits(static_cast<uint64_t>(std::ldexp(m, 64)), e - 64);
+    negative &= !isZero();
+}
+
+BigFixed::BigFixed(FloatExp value, size_t fractionLimbs)
+    : negative(value.mantissa < 0), limbs(fractionLimbs + 1, 0) {
+    setBits(static_cast<uint64_t>(std::ldexp(std::abs(value.mantissa), 64)), value.exponent - 64);
+    negative &= !isZero();
+}
+
+size_t BigFixed::limbsFor(FloatExp scale) {
+    // 32 guard bits for rounding errors of the reference orbit
+    double bits = std::max(0., -scale.log2()) + 32;
+    return std::max((size_t) 2, static_cast<size_t>(std::ceil(bits / 32)) + 1);
+}
+
+bool BigFixed::parse(std::string const& text, size_t fractionLimbs, BigFixed& res) {
+    size_t pos = text.empty() || (text[0] != '-' && text[0] != '+') ? 0 : 1;
+    const size_t point = std::min(text.find('.'), text.size());
+    if (point == pos && point + 1 >= text.size()) {
+        return false;
+    }
+
+    uint64_t integer = 0;
+    for (size_t i = pos; i < point; ++i) {
+        if (!std::isdigit(static_cast<unsigned char>(text[i])) || (integer = integer * 10 + (text[i] - '0')) > UINT32_MAX) {
+            return false;
+        }
+    }
+
+    // from the last digit: x = (x + digit) / 10, which is exact but the truncation of the last limb
+    BigFixed value(0., fractionLimbs);
+    for (size_t i = text.size(); i-- > point + 1;) {
+        if (!std::isdigit(static_cast<unsigned char>(text[i]))) {
+            return false;
+        }
+        value.limbs[0] += text[i] - '0';
+
+        uint64_t remainder = 0;
+        for (uint32_t& limb : value.limbs) {
+            uint64_t t = (remainder << 32) | limb;
+            limb = static_cast<uint32_t>(t / 10);
+            remainder = t % 10;
+        }
+    }
+
+    value.limbs[0] = static_cast<uint32_t>(integer);
+    value.negative = text[0] == '-' && !value.isZero();
+    res = value;
+    return true;
+}
+
+size_t BigFixed::precision() const {
+    return limbs.size() - 1;
+}
+
+void BigFixed::setPrecision(size_t fractionLimbs) {
+    limbs.resize(fractionLimbs + 1, 0);
+    negative &= !isZero();
+}
+
+double BigFixed::toDouble() const {
+    return toFloatExp().toDouble();
+}
+
+FloatExp BigFixed::toFloatExp() const {
+    size_t i = 0;
+    while (i < limbs.size() && limbs[i] == 0) {
+        ++i;
+    }
+    if (i == limbs.size()) {
+        return FloatExp();
+    }
+
+    // three limbs are more than enough for double mantissa
+    double acc = 0;
+    for (size_t j = i; j < i + 3; ++j) {
+        acc = acc * 4294967296. + (j < limbs.size() ? limbs[j] : 0);
+    }
+    return FloatExp(negative ? -acc : acc, -32 * static_cast<int64_t>(i) - 64);
+}
+
+std::string BigFixed::toString(size_t digits) const {
+    std::string res = (negative ? "-" : "") + std::to_string(limbs[0]) + ".";
+    std::vector<uint32_t> fraction(limbs.begin() + 1, limbs.end());
+
+    for (size_t d = 0; d < digits; ++d) {
+        uint64_t carry = 0;
+        for (size_t i = fraction.size(); i-- > 0;) {
+            uint64_t t = static_cast<uint64_t>(fraction[i]) * 10 + carry;
+            fraction[i] = static_cast<uint32_t>(t);
+            carry = t >> 32;
+        }
+        res += static_cast<char>('0' + carry);
+    }
+    return res;
+}
+
+BigFixed BigFixed::operator-() const {
+    BigFixed res = *this;
+    res.negative = !negative && !isZero();
+    return res;
+}
+
+BigFixed BigFixed::operator+(BigFixed const& other) const {
+    if (negative == other.negative) {
+        return addMagnitude(*this, other, negative);
+    }
+    if (compareMagnitude(*this, other) >= 0) {
+        return subMagnitude(*this, other, negative);
+    }
+    return subMagnitude(other, *this, other.negative);
+}
+
+BigFixed BigFixed::operator-(BigFixed const& other) const {
+    return *this + (-other);
+}
+
+BigFixed BigFixed::operator*(BigFixed const& other) const {
+    const size_t fa = precision();
+    const size_t fb = other.precision();
+    const size_t la = limbs.size();
+    const size_t lb = other.limbs.size();
+
+    // schoolbook multiplication, product[0] is the least significant limb
+    std::vector<uint32_t> product(la + lb, 0);
+
+    for (size_t i = 0; i < la; ++i) {
+        uint64_t a = limbs[la - 1 - i];
+        uint64_t carry = 0;
+
+        for (size_t j = 0; j < lb; ++j) {
+            uint64_t t = a * other.limbs[lb - 1 - j] + product[i + j] + carry;
+            product[i + j] = static_cast<uint32_t>(t);
+            carry = t >> 32;
+        }
+        product[i + lb] = static_cast<uint32_t>(carry);
+    }
+
+    // product has fa + fb fraction limbs, keep the most significant of them
+    const size_t f = std::max(fa, fb);
+    BigFixed res;
+    res.limbs.assign(f + 1, 0);
+    for (size_t k = 0; k <= f; ++k) {
+        res.limbs[k] = product[fa + fb - k];
+    }
+    res.negative = (negative != other.negative) && !res.isZero();
+    return res;
+}
+
+BigFixed& BigFixed::operator+=(BigFixed const& other) {
+    return *this = *this + other;
+}
+
+BigFixed& BigFixed::operator-=(BigFixed const& other) {
+    return *this = *this - other;
+}
+
+BigFixed& BigFixed::operator*=(BigFixed const& other) {
+    return *this = *this * other;
+}
+
+bool BigFixed::operator<(BigFixed const& other) const {
+    if (negative != other.negative) {
+        return negative;
+    }
+    int cmp = compareMagnitude(*this, other);
+    return negative ? cmp > 0 : cmp < 0;
+}
+
+bool BigFixed::operator==(BigFixed const& other) const {
+    return negative == other.negative && compareMagnitude(*this, other) == 0;
+}
+
+bool BigFixed::operator!=(BigFixed const& other) const {
+    return !(operator==(other));
+}
+
+int BigFixed::compareMagnitude(BigFixed const& a, BigFixed const& b) {
+    size_t len = std::max(a.limbs.size(), b.limbs.size());
+
+    for (size_t i = 0; i < len; ++i) {
+        uint32_t x = i < a.limbs.size() ? a.limbs[i] : 0;
+        uint32_t y = i < b.limbs.size() ? b.limbs[i] : 0;
+        if (x != y) {
+            return x < y ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+BigFixed BigFixed::addMagnitude(BigFixed const& a, BigFixed const& b, bool negative) {
+    BigFixed res;
+    res.limbs.assign(std::max(a.limbs.size(), b.limbs.size()), 0);
+    uint64_t carry = 0;
+
+    for (size_t i = res.limbs.size(); i-- > 0;) {
+        uint64_t t = carry;
+        t += i < a.limbs.size() ? a.limbs[i] : 0;
+        t += i < b.limbs.size() ? b.limbs[i] : 0;
+        res.limbs[i] = static_cast<uint32_t>(t);
+        carry = t >> 32;
+    }
+
+    res.negative = negative && !res.isZero();
+    return res;
+}
+
+BigFixed BigFixed::subMagnitude(BigFixed const& a, BigFixed const& b, bool negative) {
+    // |a| >= |b|
+    BigFixed res;
+    res.limbs.assign(std::max(a.limbs.size(), b.limbs.size()), 0);
+    int64_t borrow = 0;
+
+    for (size_t i = res.limbs.size(); i-- > 0;) {
+        int64_t t = -borrow;
+        t += i < a.limbs.size() ? a.limbs[i] : 0;
+        t -= i < b.limbs.size() ? b.limbs[i] : 0;
+        borrow = t < 0;
+        res.limbs[i] = static_cast<uint32_t>(t + (borrow << 32));
+    }
+
+    res.negative = negative && !res.isZero();
+    return res;
+}
+
+void BigFixed::setBits(uint64_t mantissa, int64_t shift) {
+    // bit 0 is the least significant bit of the last limb
+    const int64_t fractionBits = 32 * static_cast<int64_t>(precision());
+    const int64_t totalBits = 32 * static_cast<int64_t>(limbs.size());
+
+    for (int64_t k = 0; k < 64; ++k) {
+        int64_t bit = k + shift + fractionBits;
+        if (bit < 0 || bit >= totalBits || !((mantissa >> k) & 1)) {
+            continue;
+        }
+        limbs[limbs.size() - 1 - bit / 32] |= uint32_t(1) << (bit % 32);
+    }
+}
+
+bool BigFixed::isZero() const {
+    return std::all_of(limbs.begin(), limbs.end(), [](uint32_t limb) { return limb == 0; });
+}
+
+}
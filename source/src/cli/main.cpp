@@ -0,0 +1,210 @@
+#include "exporter.h"
+#include "log.h"
+#include "trace.h"
+#include "zoomsequence.h"
+#include <cmath>
+#include <cstdio>
+#include <string>
+
+namespace {
+
+const char* USAGE =
+        "usage: mandelbrot_cli [options] output.png|.tif|.ppm\n"
+        "       mandelbrot_cli [options] --zoom-to S --frames N zoom_%05d.png|zoom.rgb\n"
+        "  --center X Y      decimal coordinates of any precision, -0.5 0 by default\n"
+        "  --scale S         plane units per pixel, like 1e-300, 0.005 by default\n"
+        "  --size W H        1920 1080 by default, the large ones are rendered in bands\n"
+        "  --iterations N    up to 1048576, chosen by the scale by default\n"
+        "  --threads N       all cores by default\n"
+        "  --coloring C      linear, smooth or histogram\n"
+        "  --subdivision     skip the tiles with uniform border\n"
+        "  --zoom-to S       renders the zoom from --scale to this one, continues a stopped run\n"
+        "  --frames N        frames count of the zoom\n"
+        "  --progress        print the written rows or frames\n"
+        "  --verbose         print the renderer log\n"
+        "  --trace FILE      write the timeline of the rendering as Chrome trace JSON\n";
+
+struct Options {
+    std::string x = "-0.5";
+    std::string y = "0";
+    std::string scale = "0.005";
+    std::string zoomTo;
+    size_t frames = 0;
+    mandelbrot::Size size = {1920, 1080};
+    size_t iterations = 0;
+    size_t threads = 0;
+    mandelbrot::Coloring coloring = mandelbrot::LINEAR;
+    bool subdivision = false;
+    bool progress = false;
+    bool verbose = false;
+    std::string trace;
+    std::string output;
+};
+
+// mantissa and decimal exponent separately, so the scale may underflow double
+bool parseScale(std::string const& text, mandelbrot::FloatExp& scale) {
+    using namespace mandelbrot;
+
+    try {
+        size_t e = text.find_first_of("eE");
+        double mantissa = std::stod(text.substr(0, e));
+        double exponent = e == std::string::npos ? 0 : std::stoll(text.substr(e + 1)) * std::log2(10.);
+        double whole = std::floor(exponent);
+        scale = FloatExp(mantissa * std::exp2(exponent - whole), static_cast<int64_t>(whole));
+    } catch (std::exception const&) {
+        return false;
+    }
+    return scale > FloatExp(0.);
+}
+
+bool parseCount(char const* text, size_t& count) {
+    char* end;
+    unsigned long long value = std::strtoull(text, &end, 10);
+    count = static_cast<size_t>(value);
+    return *text != '\0' && *end == '\0';
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    using namespace mandelbrot;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const int left = argc - i - 1;
+        size_t w, h;
+
+        if (arg == "--center" && left >= 2) {
+            options.x = argv[++i];
+            options.y = argv[++i];
+        } else if (arg == "--scale" && left >= 1) {
+            options.scale = argv[++i];
+        } else if (arg == "--zoom-to" && left >= 1) {
+            options.zoomTo = argv[++i];
+        } else if (arg == "--frames" && left >= 1) {
+            if (!parseCount(argv[++i], options.frames) || options.frames == 0) {
+                return false;
+            }
+        } else if (arg == "--size" && left >= 2) {
+            if (!parseCount(argv[++i], w) || !parseCount(argv[++i], h) || w == 0 || h == 0) {
+                return false;
+            }
+            options.size = Size(static_cast<int>(w), static_cast<int>(h));
+        } else if (arg == "--iterations" && left >= 1) {
+            if (!parseCount(argv[++i], options.iterations) || options.iterations > MAX_ITERATIONS_BY_PIXEL) {
+                return false;
+            }
+        } else if (arg == "--threads" && left >= 1) {
+            if (!parseCount(argv[++i], options.threads)) {
+                return false;
+            }
+        } else if (arg == "--coloring" && left >= 1) {
+            const std::string coloring = argv[++i];
+            if (coloring == "linear") {
+                options.coloring = LINEAR;
+            } else if (coloring == "smooth") {
+                options.coloring = SMOOTH;
+            } else if (coloring == "histogram") {
+                options.coloring = HISTOGRAM;
+            } else {
+                return false;
+            }
+        } else if (arg == "--subdivision") {
+            options.subdivision = true;
+        } else if (arg == "--progress") {
+            options.progress = true;
+        } else if (arg == "--verbose") {
+            options.verbose = true;
+        } else if (arg == "--trace" && left >= 1) {
+            options.trace = argv[++i];
+        } else if (arg.rfind("--", 0) != 0 && options.output.empty()) {
+            options.output = arg;
+        } else {
+            return false;
+        }
+    }
+    return !options.output.empty() && options.zoomTo.empty() == (options.frames == 0);
+}
+
+// the trace is written whatever the result is
+int finish(Options const& options, std::string const& error) {
+    if (!options.trace.empty() && !mandelbrot::trace::stop(options.trace)) {
+        std::fprintf(stderr, "can't write %s\n", options.trace.c_str());
+    }
+    if (!error.empty()) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    return 0;
+}
+
+}
+
+// renders the given place into a file without any GUI, for batch jobs and benchmarks
+int main(int argc, char** argv) {
+    using namespace mandelbrot;
+
+    Options options;
+    FloatExp scale;
+    FloatExp zoomTo;
+    if (!parseOptions(argc, argv, options) || !parseScale(options.scale, scale)
+            || (options.frames > 0 && !parseScale(options.zoomTo, zoomTo))) {
+        std::fputs(USAGE, stderr);
+        return 2;
+    }
+
+    BigPos center;
+    const size_t precision = BigFixed::limbsFor(std::min(scale, zoomTo.isZero() ? scale : zoomTo));
+    if (!BigFixed::parse(options.x, precision, center.x) || !BigFixed::parse(options.y, precision, center.y)) {
+        std::fputs("bad center coordinates\n", stderr);
+        return 2;
+    }
+
+    if (options.verbose) {
+        setLogHandler([](std::string const& line) {
+            std::fprintf(stderr, "%s\n", line.c_str());
+        });
+    }
+
+    RendererSettings settings;
+    settings.iterationsCountAuto = options.iterations == 0;
+    settings.iterationsCount = options.iterations;
+    settings.threadsCountAuto = options.threads == 0;
+    settings.threadsCount = options.threads;
+    settings.coloring = options.coloring;
+    settings.subdivision = options.subdivision;
+
+    if (!options.trace.empty()) {
+        trace::start();
+    }
+
+    if (options.frames > 0) {
+        ZoomSequence zoom;
+        if (options.progress) {
+            zoom.setProgressCallback([](size_t frame, size_t count, double fps) {
+                std::fprintf(stderr, "%zu of %zu frames, %.2f fps\n", frame, count, fps);
+            });
+        }
+
+        return finish(options, zoom.render(options.output, center, options.size, scale, zoomTo, options.frames, settings));
+    }
+
+    // the file is streamed band by band, so any size fits the memory
+    Exporter exporter;
+    std::string error;
+    exporter.setFinishedCallback([&](std::string const& message) {
+        error = message;
+    });
+    if (options.progress) {
+        exporter.setProgressCallback([](size_t rows, size_t height) {
+            std::fprintf(stderr, "%zu of %zu rows\n", rows, height);
+        });
+    }
+
+    // the same scale log as the viewport has, for the automatic iterations count
+    const double scaleLog = 1 + std::log2(INITIAL_SCALE) - scale.log2();
+    if (!exporter.start(options.output, center, options.size, scale, scaleLog, settings)) {
+        std::fprintf(stderr, "unknown format of %s or the size is over %d\n", options.output.c_str(), Exporter::MAX_SIZE);
+        return 2;
+    }
+    exporter.wait();
+    return finish(options, error);
+}
@@ -0,0 +1,1223 @@
+#include "engine.h"
+#include "kernels.h"
+#include "log.h"
+#include "trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// float has twice as many lanes, and it is enough while pixels are much larger than its epsilon.
+// double-double is several times slower than double, but still needs no reference orbit.
+mandelbrot::kernels::Precision precisionFor(double scale) {
+    using namespace mandelbrot;
+
+    if (scale >= SINGLE_PRECISION_MIN_SCALE) {
+        return kernels::SINGLE;
+    }
+    if (scale >= DOUBLE_PRECISION_MIN_SCALE) {
+        return kernels::DOUBLE;
+    }
+    return kernels::DOUBLE_DOUBLE;
+}
+
+const char* precisionSuffix(mandelbrot::kernels::Precision precision) {
+    using namespace mandelbrot;
+
+    switch (precision) {
+    case kernels::SINGLE:
+        return ", float";
+    case kernels::DOUBLE_DOUBLE:
+        return ", double-double";
+    default:
+        return "";
+    }
+}
+
+// the grids are aligned in BigFixed, but compared in double
+const double PAN_SHIFT_TOLERANCE = 1e-6;
+// the automatic iterations count is doubled when a larger share of the frame reaches it
+const double ITERATIONS_RAISE_SHARE = 0.01;
+// and halved when no sample of the frame takes more than that share of it
+const double ITERATIONS_LOWER_SHARE = 0.25;
+// octaves the automatic count may go away from the formula
+const int MAX_ITERATIONS_SHIFT = 4;
+// and the zoom octaves it holds for, the deeper and the shallower frames start from the formula again
+const int ITERATIONS_SHIFT_DEPTH = 2;
+// farther frames start a new tile cache grid, because their offset on it is computed in double
+const double CACHE_GRID_MAX_DISTANCE = 1e9;
+// rectangles that thin are not subdivided anymore, but computed entirely
+const size_t SUBDIVISION_MIN_SIZE = 6;
+// block sizes of the progressive rendering stages, the overview goes after the first one
+const size_t PROGRESSIVE_STAGES[] = {8, mandelbrot::DOWNSCALE_LEVEL, 2, 1};
+
+// smooth coloring goes through the whole gradient every that many steps
+const double SMOOTH_COLORING_PERIOD = 64;
+const size_t GRADIENT_SIZE = 1024;
+// every worker counts its histogram in that many interleaved copies
+const size_t HISTOGRAM_COPIES = 4;
+// cyclic gradient by its key colors
+const std::pair<double, mandelbrot::Rgb> GRADIENT_KEYS[] = {
+    {0, mandelbrot::rgb(0, 7, 100)}, {0.16, mandelbrot::rgb(32, 107, 203)}, {0.42, mandelbrot::rgb(237, 255, 255)},
+    {0.6425, mandelbrot::rgb(255, 170, 0)}, {0.8575, mandelbrot::rgb(0, 2, 0)}, {1, mandelbrot::rgb(0, 7, 100)}
+};
+
+// trace keeps the pointers to the span names, so they are literals
+const char* passName(bool downscaled, size_t blockSize) {
+    if (downscaled) {
+        return "overview";
+    }
+    switch (blockSize) {
+    case 8:
+        return "stage 8";
+    case 4:
+        return "stage 4";
+    case 2:
+        return "stage 2";
+    default:
+        return "stage 1";
+    }
+}
+
+/*
+ * Fractional part of the normalized iteration count n + 1 - log2(log2 |z|).
+ * The escape radius is 2, so right after the escape log2(log2 |z|) is almost in [0, 1).
+ * Two logarithms per pixel cost more than the rest of coloring, so it is tabulated
+ * by the exponent and the highest mantissa bits of |z|^2, which is in [4, 64) there.
+ */
+class SmoothFraction {
+public:
+    SmoothFraction() {
+        for (size_t i = 0; i < SIZE; ++i) {
+            double norm = std::ldexp(1 + (i % (1 << BITS) + 0.5) / (1 << BITS), MIN_EXPONENT + i / (1 << BITS));
+            table[i] = std::clamp(1 - std::log2(0.5 * std::log2(norm)), 0., 1.);
+        }
+    }
+
+    float operator()(float norm) const {
+        uint32_t bits;
+        std::memcpy(&bits, &norm, sizeof(bits));
+        int64_t index = static_cast<int64_t>(bits >> (23 - BITS)) - ((127 + MIN_EXPONENT) << BITS);
+        return table[std::clamp<int64_t>(index, 0, SIZE - 1)];
+    }
+
+private:
+    static const int MIN_EXPONENT = 2;
+    static const int OCTAVES = 4;
+    static const int BITS = 8;
+    static const size_t SIZE = OCTAVES << BITS;
+
+    float table[SIZE];
+};
+
+const SmoothFraction smoothFraction;
+
+// colors the tile by the given pixel colors, unknown pixels take
+// the nearest known sample of the stage to the top left
+template <typename Color>
+void fillTile(mandelbrot::Image& image, mandelbrot::Escape const* pixels, mandelbrot::Tile const& tile,
+              size_t blockSize, Color color) {
+    using namespace mandelbrot;
+
+    const size_t width = image.width();
+
+    for (size_t y = tile.y0; y != tile.y1; ++y) {
+        Rgb* imgData = image.bits() + y * width;
+        Escape const* row = pixels + y * width;
+
+        if (blockSize == 1) {
+            // every pixel is known there
+            for (size_t x = tile.x0; x != tile.x1; ++x) {
+                imgData[x] = color(row[x]);
+            }
+            continue;
+        }
+
+        Escape const* sampleRow = pixels + (y - y % blockSize) * width;
+        for (size_t x = tile.x0; x != tile.x1; ++x) {
+            imgData[x] = color(row[x].known() ? row[x] : sampleRow[x - x % blockSize]);
+        }
+    }
+}
+
+mandelbrot::DoubleDouble toDoubleDouble(mandelbrot::BigFixed const& value) {
+    using namespace mandelbrot;
+
+    double hi = value.toDouble();
+    return {hi, (value - BigFixed(hi, value.precision())).toDouble()};
+}
+
+}
+
+namespace mandelbrot {
+
+Engine::Engine() = default;
+
+void Engine::setFrameCallback(std::function<void()> callback) {
+    frameCallback = std::move(callback);
+}
+
+void Engine::request(size_t frameSeqId, BigPos const& center, Size size,
+                     FloatExp scale, double scaleLog, bool lowResOnly) {
+    WorkerSettings ws = settings.load(std::memory_order_acquire); // implicit conversion
+    ws.offset = center.toPos();
+    ws.center = center;
+    ws.offsetX = toDoubleDouble(center.x);
+    ws.offsetY = toDoubleDouble(center.y);
+    ws.originalSize = size;
+    ws.scale = scale.toDouble();
+    ws.preciseScale = scale;
+    ws.scaleLog = scaleLog;
+    ws.frameSeqId = frameSeqId;
+    ws.lowResolutionOnly = lowResOnly;
+    ws.EPS = std::min(ws.scale, 1e-3);
+    ws.precision = precisionFor(ws.scale);
+    // and double-double is not enough for pixels near its epsilon
+    ws.perturbation = scale < DOUBLE_DOUBLE_PRECISION_MIN_SCALE;
+    ws.requestTime = std::chrono::steady_clock::now();
+    if (ws.iterationsCountAuto) {
+        ws.iterationsCount = ws.iterationsCountAdaptive ? iterationsCountAdapted(ws.scaleLog)
+                                                        : iterationsCountAuto(ws.scaleLog);
+    }
+
+    {
+        // BigPos is not trivially copyable, so no atomic here
+        std::lock_guard<std::mutex> lock(mutex);
+        requested = ws;
+    }
+
+    if (!running.load(std::memory_order_acquire)) {
+        shutdown.store(false, std::memory_order_relaxed);
+        dropFrame.store(false, std::memory_order_release);
+
+        // the previous thread is stopped already, so it only has to be joined
+        wait();
+        running.store(true, std::memory_order_release);
+        thread = std::thread([this] {
+            run();
+            running.store(false, std::memory_order_release);
+        });
+    } else {
+        dropFrame.store(true, std::memory_order_release);
+        cv.notify_one();
+     }
+}
+
+void Engine::stop() {
+    shutdown.store(true, std::memory_order_relaxed);
+    dropFrame.store(true, std::memory_order_release);
+    cv.notify_one();
+}
+
+void Engine::wait() {
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+RendererSettings Engine::getSettings() const {
+    auto tmp = settings.load(std::memory_order_acquire);
+    if (tmp.iterationsCountAuto) {
+        std::lock_guard<std::mutex> lock(mutex);
+        tmp.iterationsCount = requested.iterationsCount;
+    }
+    return tmp;
+}
+
+void Engine::setSettings(RendererSettings rs) {
+    if (rs.threadsCountAuto) {
+        rs.threadsCount = threadsCountAuto();
+    }
+
+    rs.threadsCount = std::clamp(rs.threadsCount, (size_t) 1, MAX_THREADS_COUNT);
+    rs.iterationsCount = std::clamp(rs.iterationsCount, MIN_ITERATIONS_BY_PIXEL, MAX_ITERATIONS_BY_PIXEL);
+    rs.tileCacheMegabytes = std::min(rs.tileCacheMegabytes, MAX_TILE_CACHE_MEGABYTES);
+    rs.tileSize = std::clamp(rs.tileSize, MIN_TILE_SIZE, TILE_SIZE) / MIN_TILE_SIZE * MIN_TILE_SIZE;
+    settings.store(rs, std::memory_order_release);
+}
+
+// the limit is far above the formula at MAX_SCALE_LOG, so it grows with the depth all the way
+size_t Engine::iterationsCountAuto(size_t scaleLog) const {
+    return std::clamp((size_t) floor(30 * scaleLog), MIN_ITERATIONS_BY_PIXEL, MAX_ITERATIONS_BY_PIXEL);
+}
+
+// the formula, corrected by the frames rendered so far
+size_t Engine::iterationsCountAdapted(size_t scaleLog) const {
+    const double count = iterationsCountAuto(scaleLog) * std::exp2(iterationsShiftAt(scaleLog));
+    return std::clamp((size_t) count, MIN_ITERATIONS_BY_PIXEL, MAX_ITERATIONS_BY_PIXEL);
+}
+
+int Engine::iterationsShiftAt(size_t scaleLog) const {
+    const IterationsShift shift = iterationsShift.load(std::memory_order_relaxed);
+    return std::abs(static_cast<int>(scaleLog) - shift.scaleLog) <= ITERATIONS_SHIFT_DEPTH ? shift.octaves : 0;
+}
+
+size_t Engine::threadsCountAuto() const {
+    return MAX_THREADS_COUNT;
+}
+
+FrameExchange& Engine::frames(bool downscaled) {
+    return downscaled ? overviewFrames : preciseFrames;
+}
+
+void Engine::run() {
+    trace::setThreadName("engine");
+
+    while(!shutdown.load(std::memory_order_relaxed)) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            current = requested;
+        }
+
+        // the interactive engine gives way to the GUI, and the exporting ones give way to it
+        if (current.priority != ThreadPriority::NORMAL && pool.size() == 0) {
+            if (current.priority == ThreadPriority::BACKGROUND) {
+                trace::setThreadName("export engine");
+            }
+            setThreadPriority(current.priority);
+            pool.setPriority(current.priority);
+        }
+
+        // threads count could be changed in parameters dialog since last frame
+        pool.resize(current.threadsCount);
+        buildPalette();
+
+        // pixels of the visited places and of the previous frame are taken as they are,
+        // for that the center is moved onto their grid
+        frameOffset = Pos();
+        tileCache.setBudget(current.tileCacheMegabytes << 20);
+        bool onCacheGrid = moveToCacheGrid();
+        size_t reused = reuseIterations(!onCacheGrid);
+        reused += loadCachedTiles(onCacheGrid);
+
+        frameStats = FrameStats();
+        frameStats.reused = reused;
+        frameStats.workersCount = std::min(current.threadsCount, FrameStats::MAX_WORKERS);
+        iteratedSteps.store(0, std::memory_order_relaxed);
+        escapedSamples.store(0, std::memory_order_relaxed);
+        convergedSamples.store(0, std::memory_order_relaxed);
+        cappedSamples.store(0, std::memory_order_relaxed);
+
+        // the reference orbit is shared by all the stages and kept while only the pixels move
+        if (current.perturbation && !orbit.matches(current.center.x, current.center.y, current.iterationsCount)) {
+            trace::Span span("reference orbit", current.frameSeqId);
+            orbit.compute(current.center.x, current.center.y, current.iterationsCount);
+        }
+
+        // the precise frame is in the middle of the overview, moved onto its blocks
+        const Size margin = current.originalSize * (DOWNSCALED_IMAGE_SIZE_MULTIPLIER - 1) / 2;
+        overviewOriginX = margin.width() / DOWNSCALE_LEVEL * DOWNSCALE_LEVEL;
+        overviewOriginY = margin.height() / DOWNSCALE_LEVEL * DOWNSCALE_LEVEL;
+
+        // every stage computes only the samples which previous ones didn't, and is delivered at once.
+        // when the precise frame is mostly ready, the coarse stages aren't worth it,
+        // and nobody looks at them when the frame is exported
+        bool panned = reused >= static_cast<size_t>(current.originalSize.width()) * current.originalSize.height() / 2;
+        bool coarse = current.progressive && !panned;
+        if (coarse && !current.lowResolutionOnly) {
+            runStage(PROGRESSIVE_STAGES[0]);
+        }
+        if (coarse || current.lowResolutionOnly) {
+            runWorkers(&Engine::workerImprecise, true, current.lowResolutionOnly);
+        }
+        if (!current.lowResolutionOnly) {
+            for (size_t stage : PROGRESSIVE_STAGES) {
+                if (stage == 1 || (current.progressive && stage < DOWNSCALE_LEVEL) || (coarse && stage == DOWNSCALE_LEVEL)) {
+                    runStage(stage);
+                }
+            }
+        }
+
+        if (!dropFrame.load(std::memory_order_acquire)) {
+            debug()
+                    << "frame " << current.frameSeqId << " samples: "
+                    << frameStats.iterations << " iterations, " << frameStats.escaped << " escaped, "
+                    << frameStats.converged << " converged, " << frameStats.capped << " at the limit, "
+                    << frameStats.reused << " pixels reused, " << frameStats.skipped << " skipped, "
+                    << frameStats.elapsedMs << " ms";
+        }
+
+        // completed pixels are right even if the frame is dropped
+        tileCache.store(current.preciseScale, current.iterationsCount, cacheGridX, cacheGridY,
+                        current.originalSize.width(), current.originalSize.height(), iterations.data());
+
+        // the frame with the raised limit goes again at once, only its pixels at the old limit are iterated
+        const bool raised = !dropFrame.load(std::memory_order_acquire) && adaptIterations();
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (raised && !dropFrame.load(std::memory_order_acquire)) {
+                requested.iterationsCount = iterationsCountAdapted(requested.scaleLog);
+                continue;
+            }
+            while (!dropFrame.load(std::memory_order_acquire)) {
+                cv.wait(lock);
+            }
+            dropFrame.store(false);
+        }
+    }
+
+    // do not keep sleeping workers when nothing is going to be rendered
+    pool.resize(0);
+}
+
+/*
+ * Moves steps of the previous precise frame to their place in the current one.
+ * It works when the frames differ by the center and maybe by 2x zoom (SCALE_STEP),
+ * because then the new pixel grid can contain the old one (or a half of it).
+ * For that the center is moved onto the old grid, by half a pixel at most,
+ * and the frame is delivered with that offset. Unless it is already on the tile cache grid,
+ * then only the pixels which happen to be aligned are reused. The rest of the pixels are marked
+ * unknown. Returns the count of reused ones.
+ * Pixels are stored only when completed, so even dropped frames are reused. The iterations limit may differ:
+ * the escapes before both limits are the same, and only the pixels which reached the lower one are iterated again.
+ */
+size_t Engine::reuseIterations(bool snap) {
+    trace::Span span("reuse", current.frameSeqId);
+    const size_t width = current.originalSize.width();
+    const size_t height = current.originalSize.height();
+    const WorkerSettings& prev = iterationsFrame;
+
+    bool compatible = !iterations.empty()
+            && prev.originalSize == current.originalSize
+            && prev.precision == current.precision
+            && prev.perturbation == current.perturbation;
+
+    // new pixels are that many old ones
+    const double ratio = compatible ? (current.preciseScale / prev.preciseScale).toDouble() : 0;
+    compatible = compatible && (ratio == 0.5 || ratio == 1 || ratio == 2);
+
+    // centers difference in the old pixels
+    double dx = 0;
+    double dy = 0;
+    if (compatible) {
+        BigPos diff = current.center - prev.center;
+        dx = (diff.x.toFloatExp() / prev.preciseScale).toDouble();
+        dy = (diff.y.toFloatExp() / prev.preciseScale).toDouble();
+        compatible = std::abs(dx) < 2 * width && std::abs(dy) < 2 * height;
+    }
+
+    if (!compatible) {
+        iterationsFrame = current;
+        iterations.assign(width * height, Escape());
+        return 0;
+    }
+
+    // old pixel x and new pixel X sample the same point, when
+    // x = d + (X + 0.5 - size / 2) * ratio + size / 2 - 0.5 is integer.
+    // for the halved pixels it is enough, that every other X gives it.
+    auto snapToGrid = [ratio](double d, size_t size) {
+        double t = (0.5 - size / 2.) * (ratio - 1);
+        double step = ratio < 1 ? 0.5 : 1;
+        return std::round((d + t) / step) * step - t;
+    };
+    if (snap) {
+        dx = snapToGrid(dx, width);
+        dy = snapToGrid(dy, height);
+
+        size_t precision = current.center.precision();
+        moveCenter(prev.center + BigPos(BigFixed(prev.preciseScale * dx, precision),
+                                        BigFixed(prev.preciseScale * dy, precision)));
+    }
+
+    // old pixel for every column and row of the new frame, or -1
+    auto mapping = [ratio](double d, size_t size) {
+        std::vector<ptrdiff_t> res(size, -1);
+        for (size_t i = 0; i < size; ++i) {
+            double from = d + (i + 0.5 - size / 2.) * ratio + size / 2. - 0.5;
+            double rounded = std::round(from);
+            if (std::abs(from - rounded) < PAN_SHIFT_TOLERANCE && rounded >= 0 && rounded < size) {
+                res[i] = static_cast<ptrdiff_t>(rounded);
+            }
+        }
+        return res;
+    };
+    const std::vector<ptrdiff_t> columns = mapping(dx, width);
+    const std::vector<ptrdiff_t> rows = mapping(dy, height);
+    size_t reused = 0;
+
+    shiftedIterations.assign(width * height, Escape());
+
+    for (size_t y = 0; y < height; ++y) {
+        if (rows[y] < 0) {
+            continue;
+        }
+
+        Escape const* src = iterations.data() + rows[y] * width;
+        Escape* dst = shiftedIterations.data() + y * width;
+
+        for (size_t x = 0; x < width; ++x) {
+            if (columns[x] >= 0) {
+                dst[x] = src[columns[x]].relimited(prev.iterationsCount, current.iterationsCount);
+                reused += dst[x].known();
+            }
+        }
+    }
+
+    iterationsFrame = current;
+    iterations.swap(shiftedIterations);
+    return reused;
+}
+
+/*
+ * The automatic iterations count follows the complete frames: it is doubled when too many of their pixels
+ * reach it, as the boundary is lost then, and halved when none of them come close, as the limit
+ * costs nothing but the points missed by the periodicity check. Returns true if it is raised.
+ */
+bool Engine::adaptIterations() {
+    if (!current.iterationsCountAuto || !current.iterationsCountAdaptive || current.lowResolutionOnly) {
+        return false;
+    }
+
+    size_t capped = 0;
+    size_t maxIterated = 0;
+    for (Escape const& pixel : iterations) {
+        if (pixel.interior() && !pixel.periodic()) {
+            ++capped;
+        } else {
+            maxIterated = std::max(maxIterated, pixel.iterated());
+        }
+    }
+
+    // the frame confirms the shift at its depth, so it follows the zoom
+    const int scaleLog = static_cast<int>(current.scaleLog);
+    const int previous = iterationsShiftAt(current.scaleLog);
+    iterationsShift.store({previous, scaleLog}, std::memory_order_relaxed);
+    int shift = previous;
+    if (capped > ITERATIONS_RAISE_SHARE * iterations.size() && shift < MAX_ITERATIONS_SHIFT) {
+        ++shift;
+    } else if (capped == 0 && maxIterated < ITERATIONS_LOWER_SHARE * current.iterationsCount
+               && shift > -MAX_ITERATIONS_SHIFT) {
+        --shift;
+    } else {
+        return false;
+    }
+
+    // the count may be at its bounds already
+    const size_t before = iterationsCountAdapted(current.scaleLog);
+    iterationsShift.store({shift, scaleLog}, std::memory_order_relaxed);
+    const size_t after = iterationsCountAdapted(current.scaleLog);
+    if (after == before) {
+        iterationsShift.store({previous, scaleLog}, std::memory_order_relaxed);
+        return false;
+    }
+
+    debug()
+            << "frame " << current.frameSeqId << " iterations: " << capped << " of " << iterations.size()
+            << " pixels at the limit, " << maxIterated << " most of the others, "
+            << current.iterationsCount << " -> " << after;
+    return after > current.iterationsCount;
+}
+
+// moves the frame center by a pixel fraction, the frame is delivered with that offset
+void Engine::moveCenter(BigPos const& center) {
+    BigPos moved = center - current.center;
+    frameOffset += Pos((moved.x.toFloatExp() / current.preciseScale).toDouble(),
+                           (moved.y.toFloatExp() / current.preciseScale).toDouble());
+
+    current.center = center;
+    current.offset = center.toPos();
+    current.offsetX = toDoubleDouble(center.x);
+    current.offsetY = toDoubleDouble(center.y);
+}
+
+// moves the center onto the tile cache grid of the zoom level, if there is one nearby
+bool Engine::moveToCacheGrid() {
+    BigPos origin;
+    if (!tileCache.origin(current.preciseScale, current.iterationsCount, origin)) {
+        return false;
+    }
+
+    // frame top left pixel on the grid
+    const double halfWidth = current.originalSize.width() / 2.;
+    const double halfHeight = current.originalSize.height() / 2.;
+    BigPos diff = current.center - origin;
+    double x = (diff.x.toFloatExp() / current.preciseScale).toDouble() - halfWidth;
+    double y = (diff.y.toFloatExp() / current.preciseScale).toDouble() - halfHeight;
+    if (std::abs(x) > CACHE_GRID_MAX_DISTANCE || std::abs(y) > CACHE_GRID_MAX_DISTANCE) {
+        return false;
+    }
+
+    cacheGridX = std::llround(x);
+    cacheGridY = std::llround(y);
+
+    size_t precision = current.center.precision();
+    moveCenter(origin + BigPos(BigFixed(current.preciseScale * (cacheGridX + halfWidth), precision),
+                               BigFixed(current.preciseScale * (cacheGridY + halfHeight), precision)));
+    return true;
+}
+
+// fills unknown pixels by the cached tiles, or starts a new grid at the frame corner
+size_t Engine::loadCachedTiles(bool onCacheGrid) {
+    trace::Span span("tile cache", current.frameSeqId);
+    const size_t width = current.originalSize.width();
+    const size_t height = current.originalSize.height();
+
+    if (!onCacheGrid) {
+        size_t precision = current.center.precision();
+        tileCache.setOrigin(current.preciseScale, current.iterationsCount,
+                            current.center - BigPos(BigFixed(current.preciseScale * (width / 2.), precision),
+                                                    BigFixed(current.preciseScale * (height / 2.), precision)));
+        cacheGridX = 0;
+        cacheGridY = 0;
+        return 0;
+    }
+
+    TileCacheStats before = tileCache.stats();
+    size_t loaded = tileCache.load(current.preciseScale, current.iterationsCount,
+                                   cacheGridX, cacheGridY, width, height, iterations.data());
+    TileCacheStats after = tileCache.stats();
+
+    debug()
+            << "frame " << current.frameSeqId << " tile cache: "
+            << after.hits - before.hits << " of " << after.lookups - before.lookups << " tiles hit, "
+            << loaded << " pixels loaded, hit rate " << 100 * after.hitRate() << "%, "
+            << (after.bytes >> 20) << " MB used";
+    return loaded;
+}
+
+void Engine::runStage(size_t blockSize) {
+    if (dropFrame.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    stageBlockSize = blockSize;
+    if (blockSize == 1 && current.subdivision) {
+        runWorkers(&Engine::workerSubdivision, false, true);
+    } else {
+        runWorkers(&Engine::workerPrecise, false, blockSize == 1);
+    }
+}
+
+void Engine::runWorkers(Worker worker, bool downscaled, bool complete) {
+    if (dropFrame.load(std::memory_order_acquire)) {
+        return;
+    }
+    trace::Span span(passName(downscaled, stageBlockSize), current.frameSeqId);
+
+    // we don't actually use alpha channel. 32-bit is only for suitable alignment.
+    // every pass draws all the pixels, so any image of the right size will do
+    Image& image = downscaled ? overview : buffer;
+    current.size = current.originalSize;
+    if (downscaled) {
+        // one pixel per block, the last ones may be cut
+        Size area = current.originalSize * DOWNSCALED_IMAGE_SIZE_MULTIPLIER;
+        current.size = Size((area.width() + DOWNSCALE_LEVEL - 1) / DOWNSCALE_LEVEL,
+                             (area.height() + DOWNSCALE_LEVEL - 1) / DOWNSCALE_LEVEL);
+    }
+    if (image.size() != current.size) {
+        image = Image(current.size);
+    }
+
+    skippedPixels.store(0, std::memory_order_relaxed);
+    auto passStart = std::chrono::steady_clock::now();
+    if (current.coloring == HISTOGRAM && !downscaled) {
+        clearHistograms();
+    }
+    std::chrono::duration<double, std::milli> cleared = std::chrono::steady_clock::now() - passStart;
+
+    runPass(worker);
+    for (size_t i = 0; i < frameStats.workersCount; ++i) {
+        frameStats.busyMs[i] += scheduler.workerStats(i).busyMs;
+    }
+    LoadBalanceStats stats = scheduler.stats();
+    double coloringMs = stats.maxColoringMs;
+    double histogramMs = stats.maxHistogramMs + cleared.count();
+
+    // equalization needs the whole stage counted, so its coloring is another pass
+    if (current.coloring == HISTOGRAM && !downscaled && !dropFrame.load(std::memory_order_acquire)) {
+        trace::Span equalization("equalization", current.frameSeqId);
+        auto start = std::chrono::steady_clock::now();
+        equalize();
+        std::chrono::duration<double, std::milli> merged = std::chrono::steady_clock::now() - start;
+        runPass(&Engine::workerColorize);
+        for (size_t i = 0; i < frameStats.workersCount; ++i) {
+            frameStats.busyMs[i] += scheduler.workerStats(i).busyMs;
+        }
+        std::chrono::duration<double, std::milli> colored = std::chrono::steady_clock::now() - start;
+        histogramMs += merged.count();
+        coloringMs += colored.count();
+    }
+
+    if (!dropFrame.load(std::memory_order_acquire)) {
+        debug()
+                << "frame " << current.frameSeqId << (downscaled ? " overview" : " stage ")
+                << (downscaled ? "" : std::to_string(stageBlockSize).c_str())
+                << " (" << (current.perturbation ? "perturbation" : kernels::active().name)
+                << (current.perturbation ? "" : precisionSuffix(current.precision))
+                << "): "
+                << stats.tiles << " tiles, " << stats.stolen << " stolen, busy "
+                << stats.maxBusyMs << " ms max / " << stats.meanBusyMs << " ms mean, coloring "
+                << coloringMs << " ms";
+        if (current.coloring == HISTOGRAM && !downscaled) {
+            debug() << "frame " << current.frameSeqId << " histogram: " << histogramMs << " ms";
+        }
+        if (current.subdivision && stageBlockSize == 1 && !downscaled) {
+            frameStats.skipped += skippedPixels.load(std::memory_order_relaxed);
+            debug()
+                    << "frame " << current.frameSeqId << " subdivision: "
+                    << skippedPixels.load(std::memory_order_relaxed) << " of "
+                    << current.size.width() * current.size.height() << " pixels skipped";
+        }
+
+        // the overview is aligned to the blocks, not to the center.
+        // viewport centers it as it is drawn, with the samples expanded to blocks
+        Pos offset = frameOffset;
+        if (downscaled) {
+            Pos margin = (Pos(current.size * DOWNSCALE_LEVEL) - Pos(current.originalSize)) / 2.;
+            offset += Pos(margin.x - overviewOriginX, margin.y - overviewOriginY);
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        std::chrono::duration<double, std::milli> pass = now - passStart;
+        std::chrono::duration<double, std::milli> elapsed = now - current.requestTime;
+        if (frameStats.passesCount < FrameStats::MAX_PASSES) {
+            frameStats.passes[frameStats.passesCount++] = {passName(downscaled, stageBlockSize), pass.count()};
+        }
+        frameStats.elapsedMs = elapsed.count();
+        frameStats.iterations = iteratedSteps.load(std::memory_order_relaxed);
+        frameStats.escaped = escapedSamples.load(std::memory_order_relaxed);
+        frameStats.converged = convergedSamples.load(std::memory_order_relaxed);
+        frameStats.capped = cappedSamples.load(std::memory_order_relaxed);
+
+        // the viewport takes the image when it gets to it, meanwhile the next one is rendered
+        FrameExchange& exchange = frames(downscaled);
+        trace::Span publishing("publish", current.frameSeqId);
+        FrameInfo& info = exchange.next();
+        info.frameSeqId = current.frameSeqId;
+        info.offset = offset;
+        info.complete = complete;
+        info.stats = frameStats;
+        if (exchange.publish(image) && frameCallback) {
+            frameCallback();
+        }
+    }
+}
+
+// the cardioid costs much more than its neighbourhood, so instead of
+// fixed strips every worker takes small tiles and steals them when idle
+void Engine::runPass(Worker worker) {
+    scheduler.reset(current.size.width(), current.size.height(), current.tileSize, current.threadsCount);
+
+    for (size_t i = 0; i < current.threadsCount; ++i) {
+        pool.submit([this, worker, i](size_t) {
+            trace::Span span("worker", current.frameSeqId);
+            auto start = std::chrono::steady_clock::now();
+            Tile tile;
+
+            while (scheduler.next(i, tile)) {
+                if (shutdown.load(std::memory_order_relaxed) || dropFrame.load(std::memory_order_relaxed)) {
+                    break;
+                }
+                trace::Span tileSpan("tile", current.frameSeqId);
+                (this->*worker)(tile, i);
+            }
+
+            std::chrono::duration<double, std::milli> busy = std::chrono::steady_clock::now() - start;
+            scheduler.workerStats(i).busyMs = busy.count();
+        });
+    }
+
+    pool.wait();
+}
+
+// the tables depend on the iterations count only, so they are built once for many frames
+void Engine::buildPalette() {
+    if (gradient.empty()) {
+        gradient.resize(GRADIENT_SIZE);
+        for (size_t i = 0, key = 0; i < GRADIENT_SIZE; ++i) {
+            double t = static_cast<double>(i) / GRADIENT_SIZE;
+            while (GRADIENT_KEYS[key + 1].first < t) {
+                ++key;
+            }
+
+            auto [from, fromColor] = GRADIENT_KEYS[key];
+            auto [to, toColor] = GRADIENT_KEYS[key + 1];
+            double k = (t - from) / (to - from);
+            auto mix = [k](int a, int b) {
+                return static_cast<int>(std::lround(a + (b - a) * k));
+            };
+            gradient[i] = rgb(mix(red(fromColor), red(toColor)),
+                               mix(green(fromColor), green(toColor)),
+                               mix(blue(fromColor), blue(toColor)));
+        }
+    }
+
+    if (palette.size() == current.iterationsCount + 1) {
+        return;
+    }
+
+    // equalized levels are linear until there is a histogram
+    palette.resize(current.iterationsCount + 1);
+    levels.resize(current.iterationsCount + 1);
+    for (size_t steps = 0; steps <= current.iterationsCount; ++steps) {
+        palette[steps] = rgb(static_cast<unsigned char>(steps * 255. / current.iterationsCount), 0, 0);
+        levels[steps] = static_cast<float>(steps) / current.iterationsCount;
+    }
+}
+
+// the bins are allocated once per iterations count and cleared up to the tops of the last stage,
+// so their cost follows the escapes of the frame, not the limit. every worker clears its own
+void Engine::clearHistograms() {
+    const size_t count = current.iterationsCount;
+    const size_t size = HISTOGRAM_COPIES * (count + 1);
+    const bool allocated = histograms.size() == current.threadsCount && histograms.front().size() == size;
+    if (!allocated) {
+        histograms.resize(current.threadsCount);
+        histogramTops.assign(current.threadsCount, 0);
+    }
+
+    for (size_t i = 0; i < current.threadsCount; ++i) {
+        pool.submit([this, i, count, size, allocated](size_t) {
+            if (!allocated) {
+                histograms[i].assign(size, 0);
+                return;
+            }
+            for (size_t copy = 0; copy < HISTOGRAM_COPIES; ++copy) {
+                uint32_t* bins = histograms[i].data() + copy * (count + 1);
+                std::fill_n(bins, histogramTops[i] + 1, 0);
+                bins[count] = 0;
+            }
+            histogramTops[i] = 0;
+        });
+    }
+    pool.wait();
+}
+
+/*
+ * Histogram equalization: every steps count gets the share of the exterior pixels
+ * which escaped faster, so the colors are spread evenly whatever the iterations count is.
+ * Per-worker histograms are merged here, every worker sums a range of the steps.
+ */
+void Engine::equalize() {
+    const size_t count = current.iterationsCount;
+    const size_t top = *std::max_element(histogramTops.begin(), histogramTops.end());
+    histogramTotal.resize(top + 1);
+
+    const size_t workers = current.threadsCount;
+    for (size_t i = 0; i < workers; ++i) {
+        pool.submit([this, i, count, top, workers](size_t) {
+            const size_t from = (top + 1) * i / workers;
+            const size_t to = (top + 1) * (i + 1) / workers;
+            std::fill(histogramTotal.begin() + from, histogramTotal.begin() + to, 0);
+            for (size_t worker = 0; worker < histograms.size(); ++worker) {
+                const size_t end = std::min<size_t>(to, histogramTops[worker] + 1);
+                for (size_t copy = 0; copy < HISTOGRAM_COPIES; ++copy) {
+                    uint32_t const* bins = histograms[worker].data() + copy * (count + 1);
+                    for (size_t steps = from; steps < end; ++steps) {
+                        histogramTotal[steps] += bins[steps];
+                    }
+                }
+            }
+        });
+    }
+    pool.wait();
+
+    uint64_t sum = 0;
+    for (size_t steps = 0; steps <= top; ++steps) {
+        sum += histogramTotal[steps];
+    }
+    if (sum == 0) {
+        return;
+    }
+
+    // the samples of the stage escape by the top, so the levels above it are not used
+    uint64_t below = 0;
+    for (size_t steps = 0; steps <= top; ++steps) {
+        levels[steps] = static_cast<float>(below) / sum;
+        below += histogramTotal[steps];
+    }
+    levels[top + 1] = 1;
+}
+
+Rgb Engine::color(Escape const& pixel) const {
+    switch (current.coloring) {
+    case SMOOTH:
+        return colorSmooth(pixel);
+    case HISTOGRAM:
+        return colorEqualized(pixel);
+    default:
+        return palette[pixel.steps];
+    }
+}
+
+Rgb Engine::colorSmooth(Escape const& pixel) const {
+    if (pixel.interior()) {
+        return rgb(0, 0, 0);
+    }
+
+    double steps = pixel.steps + smoothFraction(pixel.norm);
+    return gradient[static_cast<size_t>(steps * (GRADIENT_SIZE / SMOOTH_COLORING_PERIOD)) % GRADIENT_SIZE];
+}
+
+Rgb Engine::colorEqualized(Escape const& pixel) const {
+    if (pixel.interior()) {
+        return rgb(0, 0, 0);
+    }
+
+    // levels are interpolated as the steps are
+    float from = levels[pixel.steps];
+    float level = from + smoothFraction(pixel.norm) * (levels[pixel.steps + 1] - from);
+    return gradient[std::min(static_cast<size_t>(level * GRADIENT_SIZE), GRADIENT_SIZE - 1)];
+}
+
+/*
+ * Colors the precise frame tile, the mode is chosen once for the whole tile.
+ * Unknown pixels take the nearest known sample of the stage to the top left.
+ */
+void Engine::colorize(Tile const& tile, size_t blockSize, size_t worker) {
+    auto start = std::chrono::steady_clock::now();
+
+    switch (current.coloring) {
+    case SMOOTH:
+        fillTile(buffer, iterations.data(), tile, blockSize, [this](Escape const& pixel) {
+            return colorSmooth(pixel);
+        });
+        break;
+    case HISTOGRAM:
+        fillTile(buffer, iterations.data(), tile, blockSize, [this](Escape const& pixel) {
+            return colorEqualized(pixel);
+        });
+        break;
+    default: {
+        // plain gather from the table
+        Rgb const* lut = palette.data();
+        fillTile(buffer, iterations.data(), tile, blockSize, [lut](Escape const& pixel) {
+            return lut[pixel.steps];
+        });
+    }
+    }
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    scheduler.workerStats(worker).coloringMs += elapsed.count();
+}
+
+// the stage is colored by the next pass when equalized, so here its samples are only counted
+void Engine::finishTile(Tile const& tile, size_t blockSize, size_t worker) {
+    if (current.coloring != HISTOGRAM) {
+        colorize(tile, blockSize, worker);
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    const size_t width = buffer.width();
+    uint32_t* histogram = histograms[worker].data();
+
+    // neighbours mostly have the same steps, so they go to different copies of the histogram,
+    // instead of waiting for the previous increment of the same bin. no branches here,
+    // because the steps are unpredictable near the boundary
+    const size_t count = current.iterationsCount;
+    uint32_t top = histogramTops[worker];
+
+    for (size_t y = tile.y0; y < tile.y1; y += blockSize) {
+        Escape const* row = iterations.data() + y * width;
+        for (size_t x = tile.x0, lane = 0; x < tile.x1; x += blockSize, lane = (lane + 1) % HISTOGRAM_COPIES) {
+            // the interior ones go to the last bin, which is not used
+            const uint32_t steps = row[x].steps;
+            histogram[lane * (count + 1) + steps] += 1;
+            top = std::max(top, steps < count ? steps : 0);
+        }
+    }
+    histogramTops[worker] = top;
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    scheduler.workerStats(worker).histogramMs += elapsed.count();
+}
+
+void Engine::workerColorize(Tile const& tile, size_t worker) {
+    colorize(tile, stageBlockSize, worker);
+}
+
+/*
+ * u are pixel offsets from the center of the buffer.
+ * They are overwritten by the plane points, when the kernels are used.
+ */
+void Engine::approxSteps(double* u_r, double* u_i, size_t count, kernels::Precision precision, Escape* out) {
+    if (current.perturbation) {
+        perturbation::run(orbit, u_r, u_i, count, current.preciseScale, current.iterationsCount, current.EPS, out);
+        return;
+    }
+
+    if (precision == kernels::DOUBLE_DOUBLE) {
+        alignas(64) double c_r_lo[TILE_SIZE];
+        alignas(64) double c_i_lo[TILE_SIZE];
+
+        for (size_t i = 0; i < count; ++i) {
+            DoubleDouble c_r = current.offsetX + DoubleDouble::twoProd(u_r[i], current.scale);
+            DoubleDouble c_i = current.offsetY + DoubleDouble::twoProd(u_i[i], current.scale);
+            u_r[i] = c_r.hi;
+            u_i[i] = c_i.hi;
+            c_r_lo[i] = c_r.lo;
+            c_i_lo[i] = c_i.lo;
+        }
+        kernels::active().runDoubleDouble(u_r, c_r_lo, u_i, c_i_lo, count, current.iterationsCount, current.EPS, out);
+        return;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        u_r[i] = current.offset.x + u_r[i] * current.scale;
+        u_i[i] = current.offset.y + u_i[i] * current.scale;
+    }
+    kernels::active().get(precision)(u_r, u_i, count, current.iterationsCount, current.EPS, out);
+}
+
+/*
+ * Overview covers DOWNSCALED_IMAGE_SIZE_MULTIPLIER^2 times larger area, so zooming out shows something.
+ * One sample per DOWNSCALE_LEVEL^2 block, at its top left pixel, and the image keeps only the samples:
+ * viewport expands them back to blocks when it draws. Blocks are aligned to the precise
+ * frame pixels, so the samples inside of it are stored for the next stages.
+ */
+void Engine::workerImprecise(Tile const& tile, size_t) {
+    alignas(64) double c_r[TILE_SIZE];
+    alignas(64) double c_i[TILE_SIZE];
+    Escape steps[TILE_SIZE];
+    size_t pending[TILE_SIZE];
+    Escape values[TILE_SIZE];
+
+    const size_t width = overview.width();
+    const ptrdiff_t preciseWidth = current.originalSize.width();
+    const ptrdiff_t preciseHeight = current.originalSize.height();
+    const Pos center = Pos(current.originalSize) / 2.;
+    const size_t count = tile.x1 - tile.x0;
+
+    for (size_t y = tile.y0; y != tile.y1; ++y) {
+
+        // precise frame pixel of the samples
+        const ptrdiff_t py = y * DOWNSCALE_LEVEL - overviewOriginY;
+        size_t pendingCount = 0;
+
+        for (size_t i = 0; i < count; ++i) {
+            const ptrdiff_t px = (tile.x0 + i) * DOWNSCALE_LEVEL - overviewOriginX;
+            const bool inside = px >= 0 && px < preciseWidth && py >= 0 && py < preciseHeight;
+
+            values[i] = inside ? iterations[py * preciseWidth + px] : Escape();
+            if (!values[i].known()) {
+                auto offset = Pos(px + 0.5, py + 0.5) - center;
+                c_r[pendingCount] = offset.x;
+                c_i[pendingCount] = offset.y;
+                pending[pendingCount++] = i;
+            }
+        }
+
+        approxSteps(c_r, c_i, pendingCount, current.precision, steps);
+        countSamples(steps, pendingCount);
+
+        for (size_t j = 0; j < pendingCount; ++j) {
+            size_t i = pending[j];
+            const ptrdiff_t px = (tile.x0 + i) * DOWNSCALE_LEVEL - overviewOriginX;
+
+            values[i] = steps[j];
+            if (px >= 0 && px < preciseWidth && py >= 0 && py < preciseHeight) {
+                iterations[py * preciseWidth + px] = values[i];
+            }
+        }
+
+        Rgb* data = overview.bits() + y * width + tile.x0;
+        for (size_t i = 0; i < count; ++i) {
+            data[i] = color(values[i]);
+        }
+
+        if (shutdown.load(std::memory_order_relaxed) || dropFrame.load(std::memory_order_relaxed)) {
+            return;
+        }
+    }
+}
+
+/*
+ * Stage of the progressive rendering: samples every stageBlockSize-th pixel in both directions,
+ * unless they are known from previous stages or frames. Every pixel is shown as its nearest
+ * known sample to the top left, or as itself, when it is known.
+ */
+void Engine::workerPrecise(Tile const& tile, size_t worker) {
+    size_t pixels[TILE_SIZE];
+    size_t count = 0;
+
+    const size_t width = buffer.width();
+    const size_t blockSize = stageBlockSize;
+
+    // tiles are aligned to any block size
+    for (size_t y = tile.y0; y < tile.y1; y += blockSize) {
+        for (size_t x = tile.x0; x < tile.x1; x += blockSize) {
+            if (iterations[y * width + x].known()) {
+                continue;
+            }
+
+            pixels[count++] = y * width + x;
+            if (count == TILE_SIZE) {
+                if (!computePixels(pixels, count)) {
+                    return;
+                }
+                count = 0;
+            }
+        }
+    }
+
+    if (!computePixels(pixels, count)) {
+        return;
+    }
+    finishTile(tile, blockSize, worker);
+}
+
+/*
+ * Mariani-Silver algorithm: the set is connected, so when the border of
+ * a rectangle has the same steps everywhere, its interior has them too
+ * (almost always, thin filaments crossing the rectangle may be lost).
+ * Otherwise the rectangle is split in two, the halves share the middle line.
+ */
+void Engine::workerSubdivision(Tile const& tile, size_t worker) {
+    size_t skipped = 0;
+    if (!subdivide(tile, skipped)) {
+        return;
+    }
+
+    // border steps have to be compared before coloring, so it goes after all
+    finishTile(tile, 1, worker);
+    skippedPixels.fetch_add(skipped, std::memory_order_relaxed);
+}
+
+bool Engine::subdivide(Tile const& rect, size_t& skipped) {
+    // both the border and the interior of thin rectangles fit there
+    size_t pixels[4 * TILE_SIZE];
+    size_t count = 0;
+
+    const size_t width = buffer.width();
+    Escape* steps = iterations.data();
+
+    auto index = [width](size_t x, size_t y) {
+        return y * width + x;
+    };
+    auto enqueue = [&](size_t x, size_t y) {
+        if (!steps[index(x, y)].known()) {
+            pixels[count++] = index(x, y);
+        }
+    };
+
+    for (size_t x = rect.x0; x != rect.x1; ++x) {
+        enqueue(x, rect.y0);
+        if (rect.y1 - 1 != rect.y0) {
+            enqueue(x, rect.y1 - 1);
+        }
+    }
+    for (size_t y = rect.y0 + 1; y + 1 < rect.y1; ++y) {
+        enqueue(rect.x0, y);
+        if (rect.x1 - 1 != rect.x0) {
+            enqueue(rect.x1 - 1, y);
+        }
+    }
+
+    if (!computePixels(pixels, count)) {
+        return false;
+    }
+
+    size_t w = rect.x1 - rect.x0;
+    size_t h = rect.y1 - rect.y0;
+    if (w <= 2 || h <= 2) {
+        return true; // no interior
+    }
+
+    // smooth colors differ inside of the steps bands, so only the interior is uniform then
+    Escape value = steps[index(rect.x0, rect.y0)];
+    bool uniform = current.coloring == LINEAR || value.interior();
+    for (size_t x = rect.x0; x != rect.x1 && uniform; ++x) {
+        uniform = steps[index(x, rect.y0)].sameSteps(value) && steps[index(x, rect.y1 - 1)].sameSteps(value);
+    }
+    for (size_t y = rect.y0; y != rect.y1 && uniform; ++y) {
+        uniform = steps[index(rect.x0, y)].sameSteps(value) && steps[index(rect.x1 - 1, y)].sameSteps(value);
+    }
+    // the samples inside, known from the coarse stages and the reused pixels, have to agree too,
+    // they catch the details which slip between the border samples
+    for (size_t y = rect.y0 + 1; y + 1 < rect.y1 && uniform; ++y) {
+        for (size_t x = rect.x0 + 1; x + 1 < rect.x1 && uniform; ++x) {
+            Escape const& pixel = steps[index(x, y)];
+            uniform = !pixel.known() || pixel.sameSteps(value);
+        }
+    }
+
+    if (uniform) {
+        for (size_t y = rect.y0 + 1; y + 1 < rect.y1; ++y) {
+            for (size_t x = rect.x0 + 1; x + 1 < rect.x1; ++x) {
+                if (!steps[index(x, y)].known()) {
+                    steps[index(x, y)] = value;
+                    ++skipped;
+                }
+            }
+        }
+        return true;
+    }
+
+    if (w <= SUBDIVISION_MIN_SIZE || h <= SUBDIVISION_MIN_SIZE) {
+        count = 0;
+        for (size_t y = rect.y0 + 1; y + 1 < rect.y1; ++y) {
+            for (size_t x = rect.x0 + 1; x + 1 < rect.x1; ++x) {
+                enqueue(x, y);
+            }
+        }
+        return computePixels(pixels, count);
+    }
+
+    if (w >= h) {
+        size_t middle = rect.x0 + w / 2;
+        return subdivide({rect.x0, rect.y0, middle + 1, rect.y1}, skipped)
+                && subdivide({middle, rect.y0, rect.x1, rect.y1}, skipped);
+    }
+    size_t middle = rect.y0 + h / 2;
+    return subdivide({rect.x0, rect.y0, rect.x1, middle + 1}, skipped)
+            && subdivide({rect.x0, middle, rect.x1, rect.y1}, skipped);
+}
+
+// computes the precise pass pixels given by their indices in the buffer.
+// returns false if the frame is dropped meanwhile.
+bool Engine::computePixels(size_t const* pixels, size_t count) {
+    alignas(64) double c_r[TILE_SIZE];
+    alignas(64) double c_i[TILE_SIZE];
+    Escape steps[TILE_SIZE];
+
+    const size_t width = buffer.width();
+    const Pos center = Pos(current.size) / 2.;
+
+    for (size_t from = 0; from < count; from += TILE_SIZE) {
+        size_t batch = std::min(count - from, TILE_SIZE);
+
+        for (size_t i = 0; i < batch; ++i) {
+            size_t pixel = pixels[from + i];
+            auto offset = Pos(pixel % width + 0.5, pixel / width + 0.5) - center;
+            c_r[i] = offset.x;
+            c_i[i] = offset.y;
+        }
+
+        approxSteps(c_r, c_i, batch, current.precision, steps);
+        countSamples(steps, batch);
+
+        for (size_t i = 0; i < batch; ++i) {
+            iterations[pixels[from + i]] = steps[i];
+        }
+
+        if (shutdown.load(std::memory_order_relaxed) || dropFrame.load(std::memory_order_relaxed)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// summed per batch, so the workers hardly ever meet at the counters
+void Engine::countSamples(Escape const* steps, size_t count) {
+    uint64_t iterated = 0, escaped = 0, converged = 0;
+    for (size_t i = 0; i < count; ++i) {
+        iterated += steps[i].iterated();
+        escaped += !steps[i].interior();
+        converged += steps[i].periodic();
+    }
+    iteratedSteps.fetch_add(iterated, std::memory_order_relaxed);
+    escapedSamples.fetch_add(escaped, std::memory_order_relaxed);
+    convergedSamples.fetch_add(converged, std::memory_order_relaxed);
+    cappedSamples.fetch_add(count - escaped - converged, std::memory_order_relaxed);
+}
+
+Engine::~Engine() {
+    stop();
+    wait();
+}
+
+}
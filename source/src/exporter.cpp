@@ -0,0 +1,191 @@
+#include "exporter.h"
+#include "log.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+namespace mandelbrot {
+
+namespace {
+
+// a band is about 16 MB of colors and twice as much of escape data
+const size_t BAND_PIXELS = 1 << 22;
+
+}
+
+void Exporter::setProgressCallback(Progress callback) {
+    progressCallback = std::move(callback);
+}
+
+void Exporter::setFinishedCallback(Finished callback) {
+    finishedCallback = std::move(callback);
+}
+
+bool Exporter::start(std::string const& fileName, BigPos const& center, Size size,
+                     FloatExp scale, double scaleLog, RendererSettings settings) {
+    if (running.load(std::memory_order_acquire) || size.isEmpty() || size.width() > MAX_SIZE || size.height() > MAX_SIZE) {
+        return false;
+    }
+    std::unique_ptr<ImageWriter> writer = ImageWriter::create(fileName);
+    if (!writer) {
+        return false;
+    }
+
+    // the previous thread is finished already, so it only has to be joined
+    wait();
+    this->fileName = fileName;
+    this->center = center;
+    this->size = size;
+    this->scale = scale;
+    this->scaleLog = scaleLog;
+    this->settings = settings;
+    this->writer = std::move(writer);
+    cancelled.store(false, std::memory_order_relaxed);
+    running.store(true, std::memory_order_release);
+    thread = std::thread([this] {
+        run();
+        running.store(false, std::memory_order_release);
+    });
+    return true;
+}
+
+bool Exporter::busy() const {
+    return running.load(std::memory_order_acquire);
+}
+
+void Exporter::cancel() {
+    cancelled.store(true, std::memory_order_release);
+}
+
+void Exporter::wait() {
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+void Exporter::run() {
+    setThreadPriority(ThreadPriority::BACKGROUND);
+    auto start = std::chrono::steady_clock::now();
+
+    // bands are made of whole strips, the last one may be shorter
+    const int strip = ImageWriter::STRIP_HEIGHT;
+    const int bandHeight = std::min(size.height(), std::max<int>(strip, BAND_PIXELS / size.width() / strip * strip));
+    const size_t bands = (size.height() + bandHeight - 1) / bandHeight;
+
+    // every band is a frame of its own, so nothing is left for the cache and the coarse stages
+    RendererSettings bandSettings = settings;
+    bandSettings.progressive = false;
+    bandSettings.priority = ThreadPriority::BACKGROUND;
+    bandSettings.tileCacheMegabytes = 0;
+    bandSettings.iterationsCountAdaptive = false; // the bands have to match
+    if (bands > 1 && bandSettings.coloring == HISTOGRAM) {
+        bandSettings.coloring = SMOOTH;
+    }
+
+    Engine engine;
+    engine.setSettings(bandSettings);
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool published = false;
+    engine.setFrameCallback([&] {
+        std::lock_guard<std::mutex> lock(mutex);
+        published = true;
+        cv.notify_one();
+    });
+
+    // pixel y of the image is pixel y - y0 of the band, so the band center is moved from the image one
+    const size_t precision = center.precision();
+    auto requestBand = [&](size_t band) {
+        const int y0 = static_cast<int>(band) * bandHeight;
+        const int height = std::min(bandHeight, size.height() - y0);
+        const double shift = y0 + height / 2. - size.height() / 2.;
+        engine.request(band + 1, center + BigPos(BigFixed(0., precision), BigFixed(scale * shift, precision)),
+                       Size(size.width(), height), scale, scaleLog, false);
+    };
+
+    WorkerPool pool;
+    pool.setPriority(ThreadPriority::BACKGROUND);
+    pool.resize(engine.getSettings().threadsCount);
+
+    std::unique_ptr<ImageWriter> writer = std::move(this->writer);
+    std::string error;
+    auto fail = [&](char const* what) {
+        if (error.empty()) {
+            error = what + fileName + ": " + std::strerror(errno);
+        }
+    };
+
+    const bool opened = writer->open(fileName, size);
+    if (!opened) {
+        fail("can't create ");
+    }
+
+    FrameExchange& frames = engine.frames(false);
+    size_t rows = 0;
+    if (error.empty()) {
+        requestBand(0);
+    }
+    for (size_t band = 0; band < bands && error.empty(); ++band) {
+        // the progressive stages are skipped, so every delivered frame is the complete band
+        for (;;) {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait_for(lock, std::chrono::milliseconds(100), [&] { return published; });
+            if (cancelled.load(std::memory_order_acquire)) {
+                break;
+            }
+            if (!published) {
+                continue;
+            }
+            published = false;
+            lock.unlock();
+
+            if (frames.take() && frames.info().complete && frames.info().frameSeqId == band + 1) {
+                break;
+            }
+        }
+        if (cancelled.load(std::memory_order_acquire)) {
+            error = "export is cancelled";
+            break;
+        }
+
+        // the taken band is kept until the next take, so the next one is rendered meanwhile
+        if (band + 1 < bands) {
+            requestBand(band + 1);
+        }
+        if (!writer->write(frames.image(), pool)) {
+            fail("can't write ");
+        }
+
+        rows += frames.image().height();
+        if (progressCallback) {
+            progressCallback(rows, size.height());
+        }
+    }
+    engine.stop();
+    engine.wait();
+
+    if (opened && !writer->close()) {
+        fail("can't write ");
+    }
+    if (!error.empty()) {
+        std::remove(fileName.c_str());
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    debug()
+            << "export " << size.width() << "x" << size.height() << " in " << bands << " bands: "
+            << elapsed.count() << " s" << (error.empty() ? "" : ", ") << error;
+
+    if (finishedCallback) {
+        finishedCallback(error);
+    }
+}
+
+Exporter::~Exporter() {
+    cancel();
+    wait();
+}
+
+}
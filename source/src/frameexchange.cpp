@@ -0,0 +1,38 @@
+#include "frameexchange.h"
+
+namespace mandelbrot {
+
+FrameInfo& FrameExchange::next() {
+    return ring[back].info;
+}
+
+bool FrameExchange::publish(Image& image) {
+    ring[back].image.swap(image);
+
+    // the image goes to the middle and the old middle comes back, whether it was taken or not
+    back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+    image.swap(ring[back].image);
+
+    return !notified.exchange(true, std::memory_order_acq_rel);
+}
+
+bool FrameExchange::take() {
+    // cleared before the take, so the images published after it notify again
+    notified.store(false, std::memory_order_release);
+
+    if ((middle.load(std::memory_order_acquire) & FRESH) == 0) {
+        return false;
+    }
+    front = middle.exchange(front, std::memory_order_acq_rel) & INDEX_MASK;
+    return true;
+}
+
+Image const& FrameExchange::image() const {
+    return ring[front].image;
+}
+
+FrameInfo const& FrameExchange::info() const {
+    return ring[front].info;
+}
+
+}
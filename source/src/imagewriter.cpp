@@ -0,0 +1,365 @@
+#include "imagewriter.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <vector>
+#include <zlib.h>
+
+namespace mandelbrot {
+
+namespace {
+
+using Bytes = std::vector<unsigned char>;
+
+const int DEFLATE_LEVEL = 6;
+
+// TIFF field types
+const uint16_t SHORT = 3;
+const uint16_t LONG = 4;
+const uint16_t LONG8 = 16;
+
+void putBigEndian(Bytes& out, uint64_t value, int bytes) {
+    for (int i = bytes - 1; i >= 0; --i) {
+        out.push_back(static_cast<unsigned char>(value >> (8 * i)));
+    }
+}
+
+void putLittleEndian(Bytes& out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) {
+        out.push_back(static_cast<unsigned char>(value >> (8 * i)));
+    }
+}
+
+struct Strip {
+    Bytes data;
+    uLong adler; // of the uncompressed bytes, png only
+    size_t rawSize;
+};
+
+// rows as 8-bit RGB, every sample minus the one to the left of it: PNG "sub" filter
+// and TIFF horizontal predictor are the same, and the flat areas turn into zeros
+void differences(Image const& band, int y0, int y1, bool filterBytes, Bytes& raw) {
+    const size_t width = band.width();
+    raw.resize((y1 - y0) * (3 * width + filterBytes));
+
+    unsigned char* out = raw.data();
+    for (int y = y0; y < y1; ++y) {
+        if (filterBytes) {
+            *out++ = 1;
+        }
+
+        Rgb const* pixels = band.scanLine(y);
+        uint32_t r = 0, g = 0, b = 0;
+        for (size_t x = 0; x < width; ++x) {
+            out[0] = static_cast<unsigned char>(red(pixels[x]) - r);
+            out[1] = static_cast<unsigned char>(green(pixels[x]) - g);
+            out[2] = static_cast<unsigned char>(blue(pixels[x]) - b);
+            r = red(pixels[x]);
+            g = green(pixels[x]);
+            b = blue(pixels[x]);
+            out += 3;
+        }
+    }
+}
+
+// every strip is deflated by its own stream. zlib ones are whole,
+// raw ones end with the sync flush on a byte boundary, so they can be joined
+bool deflateStrip(Bytes const& raw, bool zlibWrapper, Bytes& out) {
+    z_stream stream = {};
+    if (deflateInit2(&stream, DEFLATE_LEVEL, Z_DEFLATED, zlibWrapper ? 15 : -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+    }
+
+    // the flush marker is a few bytes beyond the bound
+    out.resize(deflateBound(&stream, static_cast<uLong>(raw.size())) + 16);
+    stream.next_in = const_cast<Bytef*>(raw.data());
+    stream.avail_in = static_cast<uInt>(raw.size());
+    stream.next_out = out.data();
+    stream.avail_out = static_cast<uInt>(out.size());
+
+    int result = deflate(&stream, zlibWrapper ? Z_FINISH : Z_SYNC_FLUSH);
+    bool ok = zlibWrapper ? result == Z_STREAM_END : (result == Z_OK && stream.avail_in == 0 && stream.avail_out != 0);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+    return ok;
+}
+
+// strips of the band, compressed all at once on the pool
+bool compressBand(Image const& band, WorkerPool& pool, bool png, std::vector<Strip>& strips) {
+    const int height = ImageWriter::STRIP_HEIGHT;
+    strips.resize((band.height() + height - 1) / height);
+    std::atomic_bool ok = true;
+
+    for (size_t i = 0; i < strips.size(); ++i) {
+        pool.submit([&, i](size_t) {
+            Strip& strip = strips[i];
+            const int y0 = static_cast<int>(i) * height;
+
+            Bytes raw;
+            differences(band, y0, std::min(y0 + height, band.height()), png, raw);
+            strip.rawSize = raw.size();
+            strip.adler = png ? adler32(adler32(0, Z_NULL, 0), raw.data(), static_cast<uInt>(raw.size())) : 0;
+            if (!deflateStrip(raw, !png, strip.data)) {
+                ok.store(false, std::memory_order_relaxed);
+            }
+        });
+    }
+    pool.wait();
+
+    // deflate fails only when it is out of memory
+    if (!ok.load()) {
+        errno = ENOMEM;
+    }
+    return ok.load();
+}
+
+class FileWriter : public ImageWriter {
+public:
+    bool open(std::string const& fileName, Size size) override {
+        file = std::fopen(fileName.c_str(), "wb");
+        this->size = size;
+        return file != nullptr && start();
+    }
+
+    bool close() override {
+        bool ok = finish();
+        ok = std::fclose(file) == 0 && ok;
+        file = nullptr;
+        return ok;
+    }
+
+    ~FileWriter() override {
+        if (file != nullptr) {
+            std::fclose(file);
+        }
+    }
+
+protected:
+    virtual bool start() = 0;
+    virtual bool finish() = 0;
+
+    // the empty buffers have no data at all
+    bool put(Bytes const& bytes) {
+        return bytes.empty() || std::fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    }
+
+    std::FILE* file = nullptr;
+    Size size;
+};
+
+// binary PPM, the simplest format anything can convert
+class PpmWriter : public FileWriter {
+public:
+    bool write(Image const& band, WorkerPool&) override {
+        Bytes row(3 * band.width());
+        for (int y = 0; y < band.height(); ++y) {
+            Rgb const* pixels = band.scanLine(y);
+            for (int x = 0; x < band.width(); ++x) {
+                row[3 * x] = red(pixels[x]);
+                row[3 * x + 1] = green(pixels[x]);
+                row[3 * x + 2] = blue(pixels[x]);
+            }
+            if (!put(row)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+protected:
+    bool start() override {
+        return std::fprintf(file, "P6\n%d %d\n255\n", size.width(), size.height()) > 0;
+    }
+
+    bool finish() override {
+        return true;
+    }
+};
+
+class PngWriter : public FileWriter {
+public:
+    bool write(Image const& band, WorkerPool& pool) override {
+        if (!compressBand(band, pool, true, strips)) {
+            return false;
+        }
+        for (Strip const& strip : strips) {
+            adler = adler32_combine(adler, strip.adler, static_cast<z_off_t>(strip.rawSize));
+            if (!chunk("IDAT", strip.data)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+protected:
+    bool start() override {
+        Bytes header;
+        putBigEndian(header, size.width(), 4);
+        putBigEndian(header, size.height(), 4);
+        header.insert(header.end(), {8, 2, 0, 0, 0}); // 8-bit RGB, deflate, no interlace
+
+        // the zlib stream header goes first, the strips make its body
+        return put({0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'})
+                && chunk("IHDR", header)
+                && chunk("IDAT", {0x78, 0x9c});
+    }
+
+    bool finish() override {
+        // the empty final block and the checksum of all the strips
+        Bytes tail = {0x03, 0x00};
+        putBigEndian(tail, adler, 4);
+        return chunk("IDAT", tail) && chunk("IEND", {});
+    }
+
+private:
+    bool chunk(char const* type, Bytes const& data) {
+        Bytes head;
+        putBigEndian(head, data.size(), 4);
+        head.insert(head.end(), type, type + 4);
+
+        // null data would restart the checksum
+        uLong crc = crc32(0, reinterpret_cast<Bytef const*>(type), 4);
+        if (!data.empty()) {
+            crc = crc32(crc, data.data(), static_cast<uInt>(data.size()));
+        }
+        Bytes tail;
+        putBigEndian(tail, crc, 4);
+
+        return put(head) && put(data) && put(tail);
+    }
+
+    std::vector<Strip> strips;
+    uLong adler = adler32(0, Z_NULL, 0);
+};
+
+// baseline RGB TIFF with deflate strips. the directory goes after them,
+// when their offsets are known, and the header is patched to point to it
+class TiffWriter : public FileWriter {
+public:
+    bool write(Image const& band, WorkerPool& pool) override {
+        if (!compressBand(band, pool, false, strips)) {
+            return false;
+        }
+        for (Strip const& strip : strips) {
+            offsets.push_back(position);
+            counts.push_back(strip.data.size());
+            position += strip.data.size();
+            if (!put(strip.data)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+protected:
+    bool start() override {
+        // deflate hardly ever grows the data, so half of the classic limit is safe
+        big = 3ull * size.width() * size.height() > UINT32_MAX / 2;
+
+        Bytes header = {'I', 'I'};
+        if (big) {
+            putLittleEndian(header, 43, 2);
+            putLittleEndian(header, 8, 2); // offset size
+            putLittleEndian(header, 0, 2);
+            putLittleEndian(header, 0, 8);
+        } else {
+            putLittleEndian(header, 42, 2);
+            putLittleEndian(header, 0, 4);
+        }
+        position = header.size();
+        return put(header);
+    }
+
+    bool finish() override {
+        struct Entry {
+            uint16_t tag;
+            uint16_t type;
+            std::vector<uint64_t> values;
+        };
+
+        const uint16_t offsetType = big ? LONG8 : LONG;
+        const uint64_t width = size.width();
+        const uint64_t height = size.height();
+        const uint64_t rowsPerStrip = STRIP_HEIGHT;
+        const std::vector<Entry> entries = {
+            {256, LONG, {width}},
+            {257, LONG, {height}},
+            {258, SHORT, {8, 8, 8}}, // bits per sample
+            {259, SHORT, {8}}, // deflate
+            {262, SHORT, {2}}, // RGB
+            {273, offsetType, offsets},
+            {277, SHORT, {3}}, // samples per pixel
+            {278, LONG, {rowsPerStrip}},
+            {279, offsetType, counts},
+            {284, SHORT, {1}}, // chunky
+            {317, SHORT, {2}} // horizontal differences
+        };
+
+        // the directory starts on a word boundary
+        Bytes padding(position & 1);
+        position += padding.size();
+        const uint64_t directory = position;
+
+        // values which don't fit the entries follow the directory
+        const int word = big ? 8 : 4;
+        uint64_t extraOffset = position + (big ? 8 : 2) + entries.size() * (big ? 20 : 12) + word;
+        Bytes ifd;
+        Bytes extra;
+        putLittleEndian(ifd, entries.size(), big ? 8 : 2);
+        for (Entry const& entry : entries) {
+            const int typeSize = entry.type == SHORT ? 2 : entry.type == LONG ? 4 : 8;
+            Bytes values;
+            for (uint64_t value : entry.values) {
+                putLittleEndian(values, value, typeSize);
+            }
+
+            putLittleEndian(ifd, entry.tag, 2);
+            putLittleEndian(ifd, entry.type, 2);
+            putLittleEndian(ifd, entry.values.size(), word);
+            if (values.size() <= static_cast<size_t>(word)) {
+                values.resize(word);
+                ifd.insert(ifd.end(), values.begin(), values.end());
+            } else {
+                putLittleEndian(ifd, extraOffset + extra.size(), word);
+                extra.insert(extra.end(), values.begin(), values.end());
+                extra.resize((extra.size() + 1) & ~size_t(1));
+            }
+        }
+        putLittleEndian(ifd, 0, word); // no next directory
+
+        Bytes pointer;
+        putLittleEndian(pointer, directory, word);
+        return put(padding) && put(ifd) && put(extra)
+                && std::fseek(file, big ? 8 : 4, SEEK_SET) == 0 && put(pointer);
+    }
+
+private:
+    bool big = false;
+    uint64_t position = 0;
+    std::vector<uint64_t> offsets;
+    std::vector<uint64_t> counts;
+    std::vector<Strip> strips;
+};
+
+}
+
+std::unique_ptr<ImageWriter> ImageWriter::create(std::string const& fileName) {
+    size_t dot = fileName.find_last_of("./\\");
+    std::string extension = dot != std::string::npos && fileName[dot] == '.' ? fileName.substr(dot + 1) : "";
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) {
+        return std::tolower(c);
+    });
+
+    if (extension == "png") {
+        return std::make_unique<PngWriter>();
+    } else if (extension == "tif" || extension == "tiff") {
+        return std::make_unique<TiffWriter>();
+    } else if (extension == "ppm") {
+        return std::make_unique<PpmWriter>();
+    }
+    return nullptr;
+}
+
+}
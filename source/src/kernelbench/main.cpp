@@ -0,0 +1,270 @@
+#include "doubledouble.h"
+#include "kernels.h"
+#include "mandelbrot.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+const char* USAGE =
+        "usage: mandelbrot_kernelbench [options]\n"
+        "  --repeats N       timed runs of every case, 5 by default\n"
+        "  --kernel K        only this kernel: avx512, avx2, sse2 or scalar\n"
+        "  --scene S         only this scene\n"
+        "  --json FILE       write the results there as well, - for stdout\n";
+
+/*
+ * Fixed places of the plane, each a square of pixels iterated as the engine does it:
+ * batches of a tile row, pixel centers around the scene center.
+ */
+struct Scene {
+    const char* name;
+    double x, y;
+    double scale; // plane units per pixel
+    size_t iterations;
+};
+
+const Scene SCENES[] = {
+    {"initial", -0.5, 0, 4. / 512, 1000}, // the whole set, as it is opened
+    {"seahorse", -0.75, 0.1, 2e-4, 2000}, // Seahorse Valley, boundary everywhere
+    {"interior", -0.2, 0, 1e-4, 1000}, // inside of the main cardioid, periodicity check stops it
+    {"exterior", 1.5, 1.5, 1e-3, 1000}, // everything escapes at once
+    {"filament", 0, 1, 1e-9, 5000}, // dendrite around the Misiurewicz point i
+};
+
+const size_t SCENE_SIZE = 512;
+
+struct Options {
+    size_t repeats = 5;
+    std::string kernel;
+    std::string scene;
+    std::string json;
+};
+
+double mean(std::vector<double> const& values) {
+    double sum = 0;
+    for (double value : values) {
+        sum += value;
+    }
+    return sum / values.size();
+}
+
+// of the sample, so it is zero for a single run
+double variance(std::vector<double> const& values) {
+    if (values.size() < 2) {
+        return 0;
+    }
+    double m = mean(values);
+    double sum = 0;
+    for (double value : values) {
+        sum += (value - m) * (value - m);
+    }
+    return sum / (values.size() - 1);
+}
+
+struct Result {
+    std::string kernel;
+    std::string precision;
+    std::string scene;
+    size_t pixels;
+    uint64_t iterations;
+    std::vector<double> seconds;
+
+    std::vector<double> miters() const {
+        std::vector<double> res;
+        for (double s : seconds) {
+            res.push_back(iterations / s / 1e6);
+        }
+        return res;
+    }
+
+    std::vector<double> nanosPerPixel() const {
+        std::vector<double> res;
+        for (double s : seconds) {
+            res.push_back(s * 1e9 / pixels);
+        }
+        return res;
+    }
+};
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+
+        if (arg == "--repeats" && hasValue) {
+            char* end;
+            options.repeats = std::strtoul(argv[++i], &end, 10);
+            if (*end != '\0' || options.repeats == 0) {
+                return false;
+            }
+        } else if (arg == "--kernel" && hasValue) {
+            options.kernel = argv[++i];
+        } else if (arg == "--scene" && hasValue) {
+            options.scene = argv[++i];
+        } else if (arg == "--json" && hasValue) {
+            options.json = argv[++i];
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+// one run of the kernel over the whole scene, the points are given to it as the engine gives them
+double runScene(mandelbrot::kernels::Kernel const& kernel, mandelbrot::kernels::Precision precision,
+                Scene const& scene, std::vector<mandelbrot::Escape>& out) {
+    using namespace mandelbrot;
+
+    alignas(64) double c_r[TILE_SIZE];
+    alignas(64) double c_i[TILE_SIZE];
+    alignas(64) double c_r_lo[TILE_SIZE];
+    alignas(64) double c_i_lo[TILE_SIZE];
+    const double EPS = std::min(scene.scale, 1e-3);
+    const DoubleDouble x(scene.x);
+    const DoubleDouble y(scene.y);
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t row = 0; row < SCENE_SIZE; ++row) {
+        const double u_i = row + 0.5 - SCENE_SIZE / 2.;
+
+        for (size_t from = 0; from < SCENE_SIZE; from += TILE_SIZE) {
+            const size_t count = std::min(TILE_SIZE, SCENE_SIZE - from);
+            Escape* steps = out.data() + row * SCENE_SIZE + from;
+
+            for (size_t i = 0; i < count; ++i) {
+                const double u_r = from + i + 0.5 - SCENE_SIZE / 2.;
+                if (precision == kernels::DOUBLE_DOUBLE) {
+                    DoubleDouble re = x + DoubleDouble::twoProd(u_r, scene.scale);
+                    DoubleDouble im = y + DoubleDouble::twoProd(u_i, scene.scale);
+                    c_r[i] = re.hi;
+                    c_r_lo[i] = re.lo;
+                    c_i[i] = im.hi;
+                    c_i_lo[i] = im.lo;
+                } else {
+                    c_r[i] = scene.x + u_r * scene.scale;
+                    c_i[i] = scene.y + u_i * scene.scale;
+                }
+            }
+
+            if (precision == kernels::DOUBLE_DOUBLE) {
+                kernel.runDoubleDouble(c_r, c_r_lo, c_i, c_i_lo, count, scene.iterations, EPS, steps);
+            } else {
+                kernel.get(precision)(c_r, c_i, count, scene.iterations, EPS, steps);
+            }
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+void writeJson(std::FILE* file, Options const& options, std::vector<Result> const& results) {
+    using namespace mandelbrot;
+
+    char date[32];
+    std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+    std::fprintf(file, "{\n");
+    std::fprintf(file, "  \"date\": \"%s\",\n", date);
+    std::fprintf(file, "  \"active_kernel\": \"%s\",\n", kernels::active().name);
+    std::fprintf(file, "  \"scene_size\": %zu,\n", SCENE_SIZE);
+    std::fprintf(file, "  \"repeats\": %zu,\n", options.repeats);
+    std::fprintf(file, "  \"results\": [");
+    for (size_t i = 0; i < results.size(); ++i) {
+        Result const& r = results[i];
+        std::fprintf(file, "%s\n    {\"kernel\": \"%s\", \"precision\": \"%s\", \"scene\": \"%s\", "
+                           "\"pixels\": %zu, \"iterations\": %llu,\n     \"seconds\": [",
+                     i == 0 ? "" : ",", r.kernel.c_str(), r.precision.c_str(), r.scene.c_str(),
+                     r.pixels, static_cast<unsigned long long>(r.iterations));
+        for (size_t j = 0; j < r.seconds.size(); ++j) {
+            std::fprintf(file, "%s%.9g", j == 0 ? "" : ", ", r.seconds[j]);
+        }
+        std::fprintf(file, "],\n     \"miters_per_second\": {\"mean\": %.6g, \"variance\": %.6g}, "
+                           "\"ns_per_pixel\": {\"mean\": %.6g, \"variance\": %.6g}}",
+                     mean(r.miters()), variance(r.miters()),
+                     mean(r.nanosPerPixel()), variance(r.nanosPerPixel()));
+    }
+    std::fprintf(file, "\n  ]\n}\n");
+}
+
+}
+
+/*
+ * Speed of every kernel compiled in and supported by this CPU, in every precision, on the fixed scenes.
+ * One thread, as the kernels are per worker anyway. Iterations are the escape steps summed,
+ * so the interior points count the whole limit, even when the periodicity check stops them early:
+ * that's the work the kernel saves, and it shows as the higher speed.
+ */
+int main(int argc, char** argv) {
+    using namespace mandelbrot;
+
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::fputs(USAGE, stderr);
+        return 2;
+    }
+
+    const std::pair<kernels::Precision, const char*> precisions[] = {
+        {kernels::SINGLE, "single"}, {kernels::DOUBLE, "double"}, {kernels::DOUBLE_DOUBLE, "double-double"}
+    };
+
+    std::vector<Result> results;
+    std::vector<Escape> out(SCENE_SIZE * SCENE_SIZE);
+    std::printf("%-8s %-14s %-9s %12s %12s %12s %12s\n",
+                "kernel", "precision", "scene", "Miter/s", "variance", "ns/pixel", "variance");
+
+    for (kernels::Kernel const& kernel : kernels::family()) {
+        if (!kernel.supported() || (!options.kernel.empty() && options.kernel != kernel.name)) {
+            continue;
+        }
+        for (auto const& [precision, precisionName] : precisions) {
+            for (Scene const& scene : SCENES) {
+                if (!options.scene.empty() && options.scene != scene.name) {
+                    continue;
+                }
+
+                // the first run warms up the caches and the clock, it is not counted
+                Result result = {kernel.name, precisionName, scene.name, out.size(), 0, {}};
+                runScene(kernel, precision, scene, out);
+                for (Escape const& escape : out) {
+                    result.iterations += escape.steps;
+                }
+                for (size_t i = 0; i < options.repeats; ++i) {
+                    result.seconds.push_back(runScene(kernel, precision, scene, out));
+                }
+
+                std::printf("%-8s %-14s %-9s %12.2f %12.4g %12.2f %12.4g\n",
+                            kernel.name, precisionName, scene.name,
+                            mean(result.miters()), variance(result.miters()),
+                            mean(result.nanosPerPixel()), variance(result.nanosPerPixel()));
+                std::fflush(stdout);
+                results.push_back(std::move(result));
+            }
+        }
+    }
+
+    if (options.json == "-") {
+        writeJson(stdout, options, results);
+    } else if (!options.json.empty()) {
+        std::FILE* file = std::fopen(options.json.c_str(), "w");
+        if (file == nullptr) {
+            std::fprintf(stderr, "can't write %s: %s\n", options.json.c_str(), std::strerror(errno));
+            return 1;
+        }
+        writeJson(file, options, results);
+        if (std::fclose(file) != 0) {
+            std::fprintf(stderr, "can't write %s: %s\n", options.json.c_str(), std::strerror(errno));
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,430 @@
+#include "kernels.h"
+#include "kernellanes.h"
+
+#ifdef MANDELBROT_X86
+#include <immintrin.h>
+
+namespace mandelbrot::kernels {
+
+namespace {
+
+// double-double values of four lanes, see DoubleDouble for the scalar version
+struct DoubleDouble4 {
+    __m256d hi;
+    __m256d lo;
+};
+
+KERNEL_TARGET("avx2,fma")
+inline DoubleDouble4 quickTwoSum(__m256d a, __m256d b) {
+    __m256d s = _mm256_add_pd(a, b);
+    return {s, _mm256_sub_pd(b, _mm256_sub_pd(s, a))};
+}
+
+KERNEL_TARGET("avx2,fma")
+inline DoubleDouble4 add(DoubleDouble4 a, DoubleDouble4 b) {
+    __m256d s = _mm256_add_pd(a.hi, b.hi);
+    __m256d bb = _mm256_sub_pd(s, a.hi);
+    __m256d e = _mm256_add_pd(_mm256_sub_pd(a.hi, _mm256_sub_pd(s, bb)), _mm256_sub_pd(b.hi, bb));
+    return quickTwoSum(s, _mm256_add_pd(e, _mm256_add_pd(a.lo, b.lo)));
+}
+
+KERNEL_TARGET("avx2,fma")
+inline DoubleDouble4 sub(DoubleDouble4 a, DoubleDouble4 b) {
+    const __m256d signMask = _mm256_set1_pd(-0.);
+    return add(a, {_mm256_xor_pd(b.hi, signMask), _mm256_xor_pd(b.lo, signMask)});
+}
+
+KERNEL_TARGET("avx2,fma")
+inline DoubleDouble4 mul(DoubleDouble4 a, DoubleDouble4 b) {
+    __m256d p = _mm256_mul_pd(a.hi, b.hi);
+    __m256d e = _mm256_fmsub_pd(a.hi, b.hi, p);
+    e = _mm256_fmadd_pd(a.hi, b.lo, e);
+    e = _mm256_fmadd_pd(a.lo, b.hi, e);
+    return quickTwoSum(p, e);
+}
+
+KERNEL_TARGET("avx2,fma")
+inline DoubleDouble4 sqr(DoubleDouble4 a) {
+    __m256d p = _mm256_mul_pd(a.hi, a.hi);
+    __m256d e = _mm256_fmsub_pd(a.hi, a.hi, p);
+    e = _mm256_fmadd_pd(_mm256_add_pd(a.hi, a.hi), a.lo, e);
+    return quickTwoSum(p, e);
+}
+
+}
+
+KERNEL_TARGET("avx2,fma")
+void runAVX2(double const* c_r, double const* c_i, size_t count,
+             size_t iterationsCount, double EPS, Escape* out) {
+    // every lane takes the next pixel of the row as soon as its previous
+    // pixel escaped or converged, so the lanes stay busy until the row is done.
+    // periodicity checking is the same as in approxStepsPower2, except that
+    // snapshots of all the lanes are taken at once.
+
+    const __m256d radius = _mm256_set1_pd(4.);
+    const __m256d limit = _mm256_set1_pd(iterationsCount);
+    const __m256d eps = _mm256_set1_pd(EPS);
+    const __m256d one = _mm256_set1_pd(1.);
+    const __m256d signMask = _mm256_set1_pd(-0.);
+
+    Lanes<double, 4> lanes(c_r, c_i, count);
+
+    __m256d v_c_r = _mm256_load_pd(lanes.c_r);
+    __m256d v_c_i = _mm256_load_pd(lanes.c_i);
+    __m256d z_r = _mm256_setzero_pd();
+    __m256d z_i = _mm256_setzero_pd();
+    __m256d z_r_old = _mm256_setzero_pd();
+    __m256d z_i_old = _mm256_setzero_pd();
+    __m256d i = _mm256_load_pd(lanes.steps);
+    __m256d busy = _mm256_cmp_pd(i, _mm256_setzero_pd(), _CMP_GE_OQ);
+    __m256d converged = _mm256_setzero_pd();
+    size_t period = 0;
+
+    while (lanes.active > 0) {
+        __m256d z_i_sqr = _mm256_mul_pd(z_i, z_i);
+        __m256d z_r_sqr = _mm256_mul_pd(z_r, z_r);
+        __m256d check = _mm256_add_pd(z_r_sqr, z_i_sqr);
+
+        __m256d escaped = _mm256_cmp_pd(check, radius, _CMP_NLT_UQ);
+        __m256d finished = _mm256_or_pd(escaped, _mm256_cmp_pd(i, limit, _CMP_NLT_UQ));
+        finished = _mm256_and_pd(_mm256_or_pd(finished, converged), busy);
+        int finishedMask = _mm256_movemask_pd(finished);
+
+        if (finishedMask != 0) {
+            int escapedMask = _mm256_movemask_pd(escaped);
+
+            _mm256_store_pd(lanes.z_r, z_r);
+            _mm256_store_pd(lanes.z_i, z_i);
+            _mm256_store_pd(lanes.z_r_old, z_r_old);
+            _mm256_store_pd(lanes.z_i_old, z_i_old);
+            _mm256_store_pd(lanes.steps, i);
+
+            for (size_t lane = 0; lane < 4; ++lane) {
+                if (finishedMask & (1 << lane)) {
+                    lanes.retire(lane, escapedMask & (1 << lane), iterationsCount, out);
+                }
+            }
+
+            v_c_r = _mm256_load_pd(lanes.c_r);
+            v_c_i = _mm256_load_pd(lanes.c_i);
+            z_r = _mm256_load_pd(lanes.z_r);
+            z_i = _mm256_load_pd(lanes.z_i);
+            z_r_old = _mm256_load_pd(lanes.z_r_old);
+            z_i_old = _mm256_load_pd(lanes.z_i_old);
+            i = _mm256_load_pd(lanes.steps);
+            busy = _mm256_cmp_pd(i, _mm256_setzero_pd(), _CMP_GE_OQ);
+            converged = _mm256_setzero_pd();
+            continue;
+        }
+
+        __m256d z_r_tmp = _mm256_add_pd(_mm256_sub_pd(z_r_sqr, z_i_sqr), v_c_r);
+        z_i = _mm256_fmadd_pd(_mm256_add_pd(z_r, z_r), z_i, v_c_i);
+        z_r = z_r_tmp;
+        i = _mm256_add_pd(i, one);
+
+        // |z - z_old| < EPS for both of the parts
+        __m256d diff_r = _mm256_andnot_pd(signMask, _mm256_sub_pd(z_r, z_r_old));
+        __m256d diff_i = _mm256_andnot_pd(signMask, _mm256_sub_pd(z_i, z_i_old));
+        converged = _mm256_and_pd(
+                    _mm256_cmp_pd(diff_r, eps, _CMP_LT_OQ),
+                    _mm256_cmp_pd(diff_i, eps, _CMP_LT_OQ));
+
+        ++period;
+        if (period > PERIODICITY_CHECK_THRESHOLD) {
+            period = 0;
+            z_r_old = z_r;
+            z_i_old = z_i;
+        }
+    }
+}
+
+KERNEL_TARGET("avx2,fma")
+void runAVX2Single(double const* c_r, double const* c_i, size_t count,
+                   size_t iterationsCount, double EPS, Escape* out) {
+    // runAVX2 in single precision: twice as many lanes in the same register
+
+    const __m256 radius = _mm256_set1_ps(4.f);
+    const __m256 limit = _mm256_set1_ps(static_cast<float>(iterationsCount));
+    const __m256 eps = _mm256_set1_ps(static_cast<float>(EPS));
+    const __m256 one = _mm256_set1_ps(1.f);
+    const __m256 signMask = _mm256_set1_ps(-0.f);
+
+    Lanes<float, 8> lanes(c_r, c_i, count);
+
+    __m256 v_c_r = _mm256_load_ps(lanes.c_r);
+    __m256 v_c_i = _mm256_load_ps(lanes.c_i);
+    __m256 z_r = _mm256_setzero_ps();
+    __m256 z_i = _mm256_setzero_ps();
+    __m256 z_r_old = _mm256_setzero_ps();
+    __m256 z_i_old = _mm256_setzero_ps();
+    __m256 i = _mm256_load_ps(lanes.steps);
+    __m256 busy = _mm256_cmp_ps(i, _mm256_setzero_ps(), _CMP_GE_OQ);
+    __m256 converged = _mm256_setzero_ps();
+    size_t period = 0;
+
+    while (lanes.active > 0) {
+        __m256 z_i_sqr = _mm256_mul_ps(z_i, z_i);
+        __m256 z_r_sqr = _mm256_mul_ps(z_r, z_r);
+        __m256 check = _mm256_add_ps(z_r_sqr, z_i_sqr);
+
+        __m256 escaped = _mm256_cmp_ps(check, radius, _CMP_NLT_UQ);
+        __m256 finished = _mm256_or_ps(escaped, _mm256_cmp_ps(i, limit, _CMP_NLT_UQ));
+        finished = _mm256_and_ps(_mm256_or_ps(finished, converged), busy);
+        int finishedMask = _mm256_movemask_ps(finished);
+
+        if (finishedMask != 0) {
+            int escapedMask = _mm256_movemask_ps(escaped);
+
+            _mm256_store_ps(lanes.z_r, z_r);
+            _mm256_store_ps(lanes.z_i, z_i);
+            _mm256_store_ps(lanes.z_r_old, z_r_old);
+            _mm256_store_ps(lanes.z_i_old, z_i_old);
+            _mm256_store_ps(lanes.steps, i);
+
+            for (size_t lane = 0; lane < 8; ++lane) {
+                if (finishedMask & (1 << lane)) {
+                    lanes.retire(lane, escapedMask & (1 << lane), iterationsCount, out);
+                }
+            }
+
+            v_c_r = _mm256_load_ps(lanes.c_r);
+            v_c_i = _mm256_load_ps(lanes.c_i);
+            z_r = _mm256_load_ps(lanes.z_r);
+            z_i = _mm256_load_ps(lanes.z_i);
+            z_r_old = _mm256_load_ps(lanes.z_r_old);
+            z_i_old = _mm256_load_ps(lanes.z_i_old);
+            i = _mm256_load_ps(lanes.steps);
+            busy = _mm256_cmp_ps(i, _mm256_setzero_ps(), _CMP_GE_OQ);
+            converged = _mm256_setzero_ps();
+            continue;
+        }
+
+        __m256 z_r_tmp = _mm256_add_ps(_mm256_sub_ps(z_r_sqr, z_i_sqr), v_c_r);
+        z_i = _mm256_fmadd_ps(_mm256_add_ps(z_r, z_r), z_i, v_c_i);
+        z_r = z_r_tmp;
+        i = _mm256_add_ps(i, one);
+
+        // |z - z_old| < EPS for both of the parts
+        __m256 diff_r = _mm256_andnot_ps(signMask, _mm256_sub_ps(z_r, z_r_old));
+        __m256 diff_i = _mm256_andnot_ps(signMask, _mm256_sub_ps(z_i, z_i_old));
+        converged = _mm256_and_ps(
+                    _mm256_cmp_ps(diff_r, eps, _CMP_LT_OQ),
+                    _mm256_cmp_ps(diff_i, eps, _CMP_LT_OQ));
+
+        ++period;
+        if (period > PERIODICITY_CHECK_THRESHOLD) {
+            period = 0;
+            z_r_old = z_r;
+            z_i_old = z_i;
+        }
+    }
+}
+
+KERNEL_TARGET("avx2,fma")
+void runAVX2DoubleDouble(double const* c_r, double const* c_r_lo, double const* c_i, double const* c_i_lo,
+                         size_t count, size_t iterationsCount, double EPS, Escape* out) {
+    // runAVX2 in double-double. escape is checked by the hi parts only.
+
+    const __m256d radius = _mm256_set1_pd(4.);
+    const __m256d limit = _mm256_set1_pd(iterationsCount);
+    const __m256d eps = _mm256_set1_pd(EPS);
+    const __m256d one = _mm256_set1_pd(1.);
+    const __m256d signMask = _mm256_set1_pd(-0.);
+
+    DoubleDoubleLanes<4> lanes(c_r, c_r_lo, c_i, c_i_lo, count);
+
+    DoubleDouble4 v_c_r = {_mm256_load_pd(lanes.c_r), _mm256_load_pd(lanes.c_r_lo)};
+    DoubleDouble4 v_c_i = {_mm256_load_pd(lanes.c_i), _mm256_load_pd(lanes.c_i_lo)};
+    DoubleDouble4 z_r = {_mm256_setzero_pd(), _mm256_setzero_pd()};
+    DoubleDouble4 z_i = z_r;
+    DoubleDouble4 z_r_old = z_r;
+    DoubleDouble4 z_i_old = z_r;
+    __m256d i = _mm256_load_pd(lanes.steps);
+    __m256d busy = _mm256_cmp_pd(i, _mm256_setzero_pd(), _CMP_GE_OQ);
+    __m256d converged = _mm256_setzero_pd();
+    size_t period = 0;
+
+    while (lanes.active > 0) {
+        DoubleDouble4 z_r_sqr = sqr(z_r);
+        DoubleDouble4 z_i_sqr = sqr(z_i);
+        __m256d check = _mm256_add_pd(z_r_sqr.hi, z_i_sqr.hi);
+
+        __m256d escaped = _mm256_cmp_pd(check, radius, _CMP_NLT_UQ);
+        __m256d finished = _mm256_or_pd(escaped, _mm256_cmp_pd(i, limit, _CMP_NLT_UQ));
+        finished = _mm256_and_pd(_mm256_or_pd(finished, converged), busy);
+        int finishedMask = _mm256_movemask_pd(finished);
+
+        if (finishedMask != 0) {
+            int escapedMask = _mm256_movemask_pd(escaped);
+
+            _mm256_store_pd(lanes.z_r, z_r.hi);
+            _mm256_store_pd(lanes.z_r_lo, z_r.lo);
+            _mm256_store_pd(lanes.z_i, z_i.hi);
+            _mm256_store_pd(lanes.z_i_lo, z_i.lo);
+            _mm256_store_pd(lanes.z_r_old, z_r_old.hi);
+            _mm256_store_pd(lanes.z_r_old_lo, z_r_old.lo);
+            _mm256_store_pd(lanes.z_i_old, z_i_old.hi);
+            _mm256_store_pd(lanes.z_i_old_lo, z_i_old.lo);
+            _mm256_store_pd(lanes.steps, i);
+
+            for (size_t lane = 0; lane < 4; ++lane) {
+                if (finishedMask & (1 << lane)) {
+                    lanes.retire(lane, escapedMask & (1 << lane), iterationsCount, out);
+                }
+            }
+
+            v_c_r = {_mm256_load_pd(lanes.c_r), _mm256_load_pd(lanes.c_r_lo)};
+            v_c_i = {_mm256_load_pd(lanes.c_i), _mm256_load_pd(lanes.c_i_lo)};
+            z_r = {_mm256_load_pd(lanes.z_r), _mm256_load_pd(lanes.z_r_lo)};
+            z_i = {_mm256_load_pd(lanes.z_i), _mm256_load_pd(lanes.z_i_lo)};
+            z_r_old = {_mm256_load_pd(lanes.z_r_old), _mm256_load_pd(lanes.z_r_old_lo)};
+            z_i_old = {_mm256_load_pd(lanes.z_i_old), _mm256_load_pd(lanes.z_i_old_lo)};
+            i = _mm256_load_pd(lanes.steps);
+            busy = _mm256_cmp_pd(i, _mm256_setzero_pd(), _CMP_GE_OQ);
+            converged = _mm256_setzero_pd();
+            continue;
+        }
+
+        // z_i = 2 * z_r * z_i + c_i, doubling is exact
+        DoubleDouble4 z_r_z_i = mul(z_r, z_i);
+        z_r_z_i = {_mm256_add_pd(z_r_z_i.hi, z_r_z_i.hi), _mm256_add_pd(z_r_z_i.lo, z_r_z_i.lo)};
+
+        z_r = add(sub(z_r_sqr, z_i_sqr), v_c_r);
+        z_i = add(z_r_z_i, v_c_i);
+        i = _mm256_add_pd(i, one);
+
+        // hi parts are close there, so their difference is exact
+        __m256d diff_r = _mm256_add_pd(_mm256_sub_pd(z_r.hi, z_r_old.hi), _mm256_sub_pd(z_r.lo, z_r_old.lo));
+        __m256d diff_i = _mm256_add_pd(_mm256_sub_pd(z_i.hi, z_i_old.hi), _mm256_sub_pd(z_i.lo, z_i_old.lo));
+        diff_r = _mm256_andnot_pd(signMask, diff_r);
+        diff_i = _mm256_andnot_pd(signMask, diff_i);
+        converged = _mm256_and_pd(
+                    _mm256_cmp_pd(diff_r, eps, _CMP_LT_OQ),
+                    _mm256_cmp_pd(diff_i, eps, _CMP_LT_OQ));
+
+        ++period;
+        if (period > PERIODICITY_CHECK_THRESHOLD) {
+            period = 0;
+            z_r_old = z_r;
+            z_i_old = z_i;
+        }
+    }
+}
+
+
+KERNEL_TARGET("avx2,fma")
+void runAVX2Perturbation(double const* Z_r, double const* Z_i, size_t orbitSize,
+                         double const* dc_r, double const* dc_i, size_t count,
+                         size_t iterationsCount, double EPS, Escape* out) {
+    // perturbedSteps in four lanes, every one of them gathers the reference orbit at its own index.
+    // the lanes are refilled as in runAVX2, the snapshots are taken by the steps of every lane
+
+    const __m256d radius = _mm256_set1_pd(4.);
+    const __m256d limit = _mm256_set1_pd(iterationsCount);
+    const __m256d eps = _mm256_set1_pd(EPS);
+    const __m256d one = _mm256_set1_pd(1.);
+    const __m256d signMask = _mm256_set1_pd(-0.);
+    const __m256i last = _mm256_set1_epi64x(orbitSize - 1);
+
+    PerturbationLanes<4> lanes(dc_r, dc_i, count);
+
+    __m256d v_dc_r = _mm256_load_pd(lanes.dc_r);
+    __m256d v_dc_i = _mm256_load_pd(lanes.dc_i);
+    __m256d dz_r = _mm256_setzero_pd();
+    __m256d dz_i = _mm256_setzero_pd();
+    __m256d Z_r_old = _mm256_load_pd(lanes.Z_r_old);
+    __m256d Z_i_old = _mm256_load_pd(lanes.Z_i_old);
+    __m256d dz_r_old = _mm256_setzero_pd();
+    __m256d dz_i_old = _mm256_setzero_pd();
+    __m256d snapshot = _mm256_load_pd(lanes.snapshot);
+    __m256i m = _mm256_setzero_si256();
+    __m256d i = _mm256_load_pd(lanes.steps);
+    __m256d busy = _mm256_cmp_pd(i, _mm256_setzero_pd(), _CMP_GE_OQ);
+
+    while (lanes.active > 0) {
+        __m256d ref_r = _mm256_i64gather_pd(Z_r, m, 8);
+        __m256d ref_i = _mm256_i64gather_pd(Z_i, m, 8);
+        __m256d z_r = _mm256_add_pd(ref_r, dz_r);
+        __m256d z_i = _mm256_add_pd(ref_i, dz_i);
+        __m256d norm = _mm256_fmadd_pd(z_r, z_r, _mm256_mul_pd(z_i, z_i));
+
+        // |z - z_old| < EPS for both of the parts, the reference ones cancel out on its cycle
+        __m256d diff_r = _mm256_add_pd(_mm256_sub_pd(ref_r, Z_r_old), _mm256_sub_pd(dz_r, dz_r_old));
+        __m256d diff_i = _mm256_add_pd(_mm256_sub_pd(ref_i, Z_i_old), _mm256_sub_pd(dz_i, dz_i_old));
+        __m256d converged = _mm256_and_pd(
+                    _mm256_cmp_pd(_mm256_andnot_pd(signMask, diff_r), eps, _CMP_LT_OQ),
+                    _mm256_cmp_pd(_mm256_andnot_pd(signMask, diff_i), eps, _CMP_LT_OQ));
+
+        __m256d escaped = _mm256_cmp_pd(norm, radius, _CMP_NLT_UQ);
+        __m256d finished = _mm256_or_pd(escaped, _mm256_cmp_pd(i, limit, _CMP_NLT_UQ));
+        finished = _mm256_and_pd(_mm256_or_pd(finished, converged), busy);
+        int finishedMask = _mm256_movemask_pd(finished);
+
+        if (finishedMask != 0) {
+            int escapedMask = _mm256_movemask_pd(escaped);
+
+            _mm256_store_pd(lanes.z_r, z_r);
+            _mm256_store_pd(lanes.z_i, z_i);
+            _mm256_store_pd(lanes.dz_r, dz_r);
+            _mm256_store_pd(lanes.dz_i, dz_i);
+            _mm256_store_pd(lanes.Z_r_old, Z_r_old);
+            _mm256_store_pd(lanes.Z_i_old, Z_i_old);
+            _mm256_store_pd(lanes.dz_r_old, dz_r_old);
+            _mm256_store_pd(lanes.dz_i_old, dz_i_old);
+            _mm256_store_pd(lanes.snapshot, snapshot);
+            _mm256_store_pd(lanes.steps, i);
+            _mm256_store_si256(reinterpret_cast<__m256i*>(lanes.m), m);
+
+            for (size_t lane = 0; lane < 4; ++lane) {
+                if (finishedMask & (1 << lane)) {
+                    lanes.retire(lane, escapedMask & (1 << lane), iterationsCount, out);
+                }
+            }
+
+            v_dc_r = _mm256_load_pd(lanes.dc_r);
+            v_dc_i = _mm256_load_pd(lanes.dc_i);
+            dz_r = _mm256_load_pd(lanes.dz_r);
+            dz_i = _mm256_load_pd(lanes.dz_i);
+            Z_r_old = _mm256_load_pd(lanes.Z_r_old);
+            Z_i_old = _mm256_load_pd(lanes.Z_i_old);
+            dz_r_old = _mm256_load_pd(lanes.dz_r_old);
+            dz_i_old = _mm256_load_pd(lanes.dz_i_old);
+            snapshot = _mm256_load_pd(lanes.snapshot);
+            m = _mm256_load_si256(reinterpret_cast<__m256i const*>(lanes.m));
+            i = _mm256_load_pd(lanes.steps);
+            busy = _mm256_cmp_pd(i, _mm256_setzero_pd(), _CMP_GE_OQ);
+            continue;
+        }
+
+        __m256d taken = _mm256_cmp_pd(i, snapshot, _CMP_EQ_OQ);
+        Z_r_old = _mm256_blendv_pd(Z_r_old, ref_r, taken);
+        Z_i_old = _mm256_blendv_pd(Z_i_old, ref_i, taken);
+        dz_r_old = _mm256_blendv_pd(dz_r_old, dz_r, taken);
+        dz_i_old = _mm256_blendv_pd(dz_i_old, dz_i, taken);
+        snapshot = _mm256_blendv_pd(snapshot, _mm256_add_pd(snapshot, snapshot), taken);
+
+        // rebased lanes go on from Z[0] = 0
+        __m256d dz_norm = _mm256_fmadd_pd(dz_r, dz_r, _mm256_mul_pd(dz_i, dz_i));
+        __m256d rebased = _mm256_or_pd(_mm256_cmp_pd(norm, dz_norm, _CMP_LT_OQ),
+                                       _mm256_castsi256_pd(_mm256_cmpeq_epi64(m, last)));
+        dz_r = _mm256_blendv_pd(dz_r, z_r, rebased);
+        dz_i = _mm256_blendv_pd(dz_i, z_i, rebased);
+        ref_r = _mm256_andnot_pd(rebased, ref_r);
+        ref_i = _mm256_andnot_pd(rebased, ref_i);
+        m = _mm256_andnot_si256(_mm256_castpd_si256(rebased), m);
+
+        __m256d t_r = _mm256_add_pd(_mm256_add_pd(ref_r, ref_r), dz_r);
+        __m256d t_i = _mm256_add_pd(_mm256_add_pd(ref_i, ref_i), dz_i);
+        __m256d dz_r_tmp = _mm256_add_pd(_mm256_fmsub_pd(t_r, dz_r, _mm256_mul_pd(t_i, dz_i)), v_dc_r);
+        dz_i = _mm256_add_pd(_mm256_fmadd_pd(t_r, dz_i, _mm256_mul_pd(t_i, dz_r)), v_dc_i);
+        dz_r = dz_r_tmp;
+
+        // busy mask is -1 in every lane, idle ones stay at the start of the orbit
+        m = _mm256_sub_epi64(m, _mm256_castpd_si256(busy));
+        i = _mm256_add_pd(i, one);
+    }
+}
+
+}
+
+#endif
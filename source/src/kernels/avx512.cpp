@@ -0,0 +1,406 @@
+#include "kernels.h"
+#include "kernellanes.h"
+
+#ifdef MANDELBROT_X86
+#include <immintrin.h>
+
+namespace mandelbrot::kernels {
+
+namespace {
+
+// double-double values of eight lanes, see DoubleDouble4 in avx2.cpp
+struct DoubleDouble8 {
+    __m512d hi;
+    __m512d lo;
+};
+
+KERNEL_TARGET("avx512f")
+inline DoubleDouble8 quickTwoSum(__m512d a, __m512d b) {
+    __m512d s = _mm512_add_pd(a, b);
+    return {s, _mm512_sub_pd(b, _mm512_sub_pd(s, a))};
+}
+
+KERNEL_TARGET("avx512f")
+inline DoubleDouble8 add(DoubleDouble8 a, DoubleDouble8 b) {
+    __m512d s = _mm512_add_pd(a.hi, b.hi);
+    __m512d bb = _mm512_sub_pd(s, a.hi);
+    __m512d e = _mm512_add_pd(_mm512_sub_pd(a.hi, _mm512_sub_pd(s, bb)), _mm512_sub_pd(b.hi, bb));
+    return quickTwoSum(s, _mm512_add_pd(e, _mm512_add_pd(a.lo, b.lo)));
+}
+
+KERNEL_TARGET("avx512f")
+inline DoubleDouble8 sub(DoubleDouble8 a, DoubleDouble8 b) {
+    __m512d zero = _mm512_setzero_pd();
+    return add(a, {_mm512_sub_pd(zero, b.hi), _mm512_sub_pd(zero, b.lo)});
+}
+
+KERNEL_TARGET("avx512f")
+inline DoubleDouble8 mul(DoubleDouble8 a, DoubleDouble8 b) {
+    __m512d p = _mm512_mul_pd(a.hi, b.hi);
+    __m512d e = _mm512_fmsub_pd(a.hi, b.hi, p);
+    e = _mm512_fmadd_pd(a.hi, b.lo, e);
+    e = _mm512_fmadd_pd(a.lo, b.hi, e);
+    return quickTwoSum(p, e);
+}
+
+KERNEL_TARGET("avx512f")
+inline DoubleDouble8 sqr(DoubleDouble8 a) {
+    __m512d p = _mm512_mul_pd(a.hi, a.hi);
+    __m512d e = _mm512_fmsub_pd(a.hi, a.hi, p);
+    e = _mm512_fmadd_pd(_mm512_add_pd(a.hi, a.hi), a.lo, e);
+    return quickTwoSum(p, e);
+}
+
+}
+
+KERNEL_TARGET("avx512f")
+void runAVX512(double const* c_r, double const* c_i, size_t count,
+               size_t iterationsCount, double EPS, Escape* out) {
+    // the same lanes refilling as in runAVX2, but eight lanes wide.
+    // comparisons give mask registers here, so no movemask is needed.
+
+    const __m512d radius = _mm512_set1_pd(4.);
+    const __m512d limit = _mm512_set1_pd(iterationsCount);
+    const __m512d eps = _mm512_set1_pd(EPS);
+    const __m512d one = _mm512_set1_pd(1.);
+
+    Lanes<double, 8> lanes(c_r, c_i, count);
+
+    __m512d v_c_r = _mm512_load_pd(lanes.c_r);
+    __m512d v_c_i = _mm512_load_pd(lanes.c_i);
+    __m512d z_r = _mm512_setzero_pd();
+    __m512d z_i = _mm512_setzero_pd();
+    __m512d z_r_old = _mm512_setzero_pd();
+    __m512d z_i_old = _mm512_setzero_pd();
+    __m512d i = _mm512_load_pd(lanes.steps);
+    __mmask8 busy = _mm512_cmp_pd_mask(i, _mm512_setzero_pd(), _CMP_GE_OQ);
+    __mmask8 converged = 0;
+    size_t period = 0;
+
+    while (lanes.active > 0) {
+        __m512d z_i_sqr = _mm512_mul_pd(z_i, z_i);
+        __m512d z_r_sqr = _mm512_mul_pd(z_r, z_r);
+        __m512d check = _mm512_add_pd(z_r_sqr, z_i_sqr);
+
+        __mmask8 escaped = _mm512_cmp_pd_mask(check, radius, _CMP_NLT_UQ);
+        __mmask8 finished = escaped | _mm512_cmp_pd_mask(i, limit, _CMP_NLT_UQ) | converged;
+        finished &= busy;
+
+        if (finished != 0) {
+            _mm512_store_pd(lanes.z_r, z_r);
+            _mm512_store_pd(lanes.z_i, z_i);
+            _mm512_store_pd(lanes.z_r_old, z_r_old);
+            _mm512_store_pd(lanes.z_i_old, z_i_old);
+            _mm512_store_pd(lanes.steps, i);
+
+            for (size_t lane = 0; lane < 8; ++lane) {
+                if (finished & (1 << lane)) {
+                    lanes.retire(lane, escaped & (1 << lane), iterationsCount, out);
+                }
+            }
+
+            v_c_r = _mm512_load_pd(lanes.c_r);
+            v_c_i = _mm512_load_pd(lanes.c_i);
+            z_r = _mm512_load_pd(lanes.z_r);
+            z_i = _mm512_load_pd(lanes.z_i);
+            z_r_old = _mm512_load_pd(lanes.z_r_old);
+            z_i_old = _mm512_load_pd(lanes.z_i_old);
+            i = _mm512_load_pd(lanes.steps);
+            busy = _mm512_cmp_pd_mask(i, _mm512_setzero_pd(), _CMP_GE_OQ);
+            converged = 0;
+            continue;
+        }
+
+        __m512d z_r_tmp = _mm512_add_pd(_mm512_sub_pd(z_r_sqr, z_i_sqr), v_c_r);
+        z_i = _mm512_fmadd_pd(_mm512_add_pd(z_r, z_r), z_i, v_c_i);
+        z_r = z_r_tmp;
+        i = _mm512_add_pd(i, one);
+
+        // |z - z_old| < EPS for both of the parts
+        __m512d diff_r = _mm512_abs_pd(_mm512_sub_pd(z_r, z_r_old));
+        __m512d diff_i = _mm512_abs_pd(_mm512_sub_pd(z_i, z_i_old));
+        converged = _mm512_cmp_pd_mask(diff_r, eps, _CMP_LT_OQ)
+                & _mm512_cmp_pd_mask(diff_i, eps, _CMP_LT_OQ);
+
+        ++period;
+        if (period > PERIODICITY_CHECK_THRESHOLD) {
+            period = 0;
+            z_r_old = z_r;
+            z_i_old = z_i;
+        }
+    }
+}
+
+KERNEL_TARGET("avx512f")
+void runAVX512Single(double const* c_r, double const* c_i, size_t count,
+                     size_t iterationsCount, double EPS, Escape* out) {
+    // runAVX512 in single precision: sixteen lanes wide
+
+    const __m512 radius = _mm512_set1_ps(4.f);
+    const __m512 limit = _mm512_set1_ps(static_cast<float>(iterationsCount));
+    const __m512 eps = _mm512_set1_ps(static_cast<float>(EPS));
+    const __m512 one = _mm512_set1_ps(1.f);
+
+    Lanes<float, 16> lanes(c_r, c_i, count);
+
+    __m512 v_c_r = _mm512_load_ps(lanes.c_r);
+    __m512 v_c_i = _mm512_load_ps(lanes.c_i);
+    __m512 z_r = _mm512_setzero_ps();
+    __m512 z_i = _mm512_setzero_ps();
+    __m512 z_r_old = _mm512_setzero_ps();
+    __m512 z_i_old = _mm512_setzero_ps();
+    __m512 i = _mm512_load_ps(lanes.steps);
+    __mmask16 busy = _mm512_cmp_ps_mask(i, _mm512_setzero_ps(), _CMP_GE_OQ);
+    __mmask16 converged = 0;
+    size_t period = 0;
+
+    while (lanes.active > 0) {
+        __m512 z_i_sqr = _mm512_mul_ps(z_i, z_i);
+        __m512 z_r_sqr = _mm512_mul_ps(z_r, z_r);
+        __m512 check = _mm512_add_ps(z_r_sqr, z_i_sqr);
+
+        __mmask16 escaped = _mm512_cmp_ps_mask(check, radius, _CMP_NLT_UQ);
+        __mmask16 finished = escaped | _mm512_cmp_ps_mask(i, limit, _CMP_NLT_UQ) | converged;
+        finished &= busy;
+
+        if (finished != 0) {
+            _mm512_store_ps(lanes.z_r, z_r);
+            _mm512_store_ps(lanes.z_i, z_i);
+            _mm512_store_ps(lanes.z_r_old, z_r_old);
+            _mm512_store_ps(lanes.z_i_old, z_i_old);
+            _mm512_store_ps(lanes.steps, i);
+
+            for (size_t lane = 0; lane < 16; ++lane) {
+                if (finished & (1 << lane)) {
+                    lanes.retire(lane, escaped & (1 << lane), iterationsCount, out);
+                }
+            }
+
+            v_c_r = _mm512_load_ps(lanes.c_r);
+            v_c_i = _mm512_load_ps(lanes.c_i);
+            z_r = _mm512_load_ps(lanes.z_r);
+            z_i = _mm512_load_ps(lanes.z_i);
+            z_r_old = _mm512_load_ps(lanes.z_r_old);
+            z_i_old = _mm512_load_ps(lanes.z_i_old);
+            i = _mm512_load_ps(lanes.steps);
+            busy = _mm512_cmp_ps_mask(i, _mm512_setzero_ps(), _CMP_GE_OQ);
+            converged = 0;
+            continue;
+        }
+
+        __m512 z_r_tmp = _mm512_add_ps(_mm512_sub_ps(z_r_sqr, z_i_sqr), v_c_r);
+        z_i = _mm512_fmadd_ps(_mm512_add_ps(z_r, z_r), z_i, v_c_i);
+        z_r = z_r_tmp;
+        i = _mm512_add_ps(i, one);
+
+        // |z - z_old| < EPS for both of the parts
+        __m512 diff_r = _mm512_abs_ps(_mm512_sub_ps(z_r, z_r_old));
+        __m512 diff_i = _mm512_abs_ps(_mm512_sub_ps(z_i, z_i_old));
+        converged = _mm512_cmp_ps_mask(diff_r, eps, _CMP_LT_OQ)
+                & _mm512_cmp_ps_mask(diff_i, eps, _CMP_LT_OQ);
+
+        ++period;
+        if (period > PERIODICITY_CHECK_THRESHOLD) {
+            period = 0;
+            z_r_old = z_r;
+            z_i_old = z_i;
+        }
+    }
+}
+
+KERNEL_TARGET("avx512f")
+void runAVX512DoubleDouble(double const* c_r, double const* c_r_lo, double const* c_i, double const* c_i_lo,
+                           size_t count, size_t iterationsCount, double EPS, Escape* out) {
+    // runAVX2DoubleDouble, eight lanes wide
+
+    const __m512d radius = _mm512_set1_pd(4.);
+    const __m512d limit = _mm512_set1_pd(iterationsCount);
+    const __m512d eps = _mm512_set1_pd(EPS);
+    const __m512d one = _mm512_set1_pd(1.);
+
+    DoubleDoubleLanes<8> lanes(c_r, c_r_lo, c_i, c_i_lo, count);
+
+    DoubleDouble8 v_c_r = {_mm512_load_pd(lanes.c_r), _mm512_load_pd(lanes.c_r_lo)};
+    DoubleDouble8 v_c_i = {_mm512_load_pd(lanes.c_i), _mm512_load_pd(lanes.c_i_lo)};
+    DoubleDouble8 z_r = {_mm512_setzero_pd(), _mm512_setzero_pd()};
+    DoubleDouble8 z_i = z_r;
+    DoubleDouble8 z_r_old = z_r;
+    DoubleDouble8 z_i_old = z_r;
+    __m512d i = _mm512_load_pd(lanes.steps);
+    __mmask8 busy = _mm512_cmp_pd_mask(i, _mm512_setzero_pd(), _CMP_GE_OQ);
+    __mmask8 converged = 0;
+    size_t period = 0;
+
+    while (lanes.active > 0) {
+        DoubleDouble8 z_r_sqr = sqr(z_r);
+        DoubleDouble8 z_i_sqr = sqr(z_i);
+        __m512d check = _mm512_add_pd(z_r_sqr.hi, z_i_sqr.hi);
+
+        __mmask8 escaped = _mm512_cmp_pd_mask(check, radius, _CMP_NLT_UQ);
+        __mmask8 finished = escaped | _mm512_cmp_pd_mask(i, limit, _CMP_NLT_UQ) | converged;
+        finished &= busy;
+
+        if (finished != 0) {
+            _mm512_store_pd(lanes.z_r, z_r.hi);
+            _mm512_store_pd(lanes.z_r_lo, z_r.lo);
+            _mm512_store_pd(lanes.z_i, z_i.hi);
+            _mm512_store_pd(lanes.z_i_lo, z_i.lo);
+            _mm512_store_pd(lanes.z_r_old, z_r_old.hi);
+            _mm512_store_pd(lanes.z_r_old_lo, z_r_old.lo);
+            _mm512_store_pd(lanes.z_i_old, z_i_old.hi);
+            _mm512_store_pd(lanes.z_i_old_lo, z_i_old.lo);
+            _mm512_store_pd(lanes.steps, i);
+
+            for (size_t lane = 0; lane < 8; ++lane) {
+                if (finished & (1 << lane)) {
+                    lanes.retire(lane, escaped & (1 << lane), iterationsCount, out);
+                }
+            }
+
+            v_c_r = {_mm512_load_pd(lanes.c_r), _mm512_load_pd(lanes.c_r_lo)};
+            v_c_i = {_mm512_load_pd(lanes.c_i), _mm512_load_pd(lanes.c_i_lo)};
+            z_r = {_mm512_load_pd(lanes.z_r), _mm512_load_pd(lanes.z_r_lo)};
+            z_i = {_mm512_load_pd(lanes.z_i), _mm512_load_pd(lanes.z_i_lo)};
+            z_r_old = {_mm512_load_pd(lanes.z_r_old), _mm512_load_pd(lanes.z_r_old_lo)};
+            z_i_old = {_mm512_load_pd(lanes.z_i_old), _mm512_load_pd(lanes.z_i_old_lo)};
+            i = _mm512_load_pd(lanes.steps);
+            busy = _mm512_cmp_pd_mask(i, _mm512_setzero_pd(), _CMP_GE_OQ);
+            converged = 0;
+            continue;
+        }
+
+        // z_i = 2 * z_r * z_i + c_i, doubling is exact
+        DoubleDouble8 z_r_z_i = mul(z_r, z_i);
+        z_r_z_i = {_mm512_add_pd(z_r_z_i.hi, z_r_z_i.hi), _mm512_add_pd(z_r_z_i.lo, z_r_z_i.lo)};
+
+        z_r = add(sub(z_r_sqr, z_i_sqr), v_c_r);
+        z_i = add(z_r_z_i, v_c_i);
+        i = _mm512_add_pd(i, one);
+
+        // hi parts are close there, so their difference is exact
+        __m512d diff_r = _mm512_add_pd(_mm512_sub_pd(z_r.hi, z_r_old.hi), _mm512_sub_pd(z_r.lo, z_r_old.lo));
+        __m512d diff_i = _mm512_add_pd(_mm512_sub_pd(z_i.hi, z_i_old.hi), _mm512_sub_pd(z_i.lo, z_i_old.lo));
+        converged = _mm512_cmp_pd_mask(_mm512_abs_pd(diff_r), eps, _CMP_LT_OQ)
+                & _mm512_cmp_pd_mask(_mm512_abs_pd(diff_i), eps, _CMP_LT_OQ);
+
+        ++period;
+        if (period > PERIODICITY_CHECK_THRESHOLD) {
+            period = 0;
+            z_r_old = z_r;
+            z_i_old = z_i;
+        }
+    }
+}
+
+
+KERNEL_TARGET("avx512f")
+void runAVX512Perturbation(double const* Z_r, double const* Z_i, size_t orbitSize,
+                           double const* dc_r, double const* dc_i, size_t count,
+                           size_t iterationsCount, double EPS, Escape* out) {
+    // runAVX2Perturbation in eight lanes, the masks select the lanes instead of the blends
+
+    const __m512d radius = _mm512_set1_pd(4.);
+    const __m512d limit = _mm512_set1_pd(iterationsCount);
+    const __m512d eps = _mm512_set1_pd(EPS);
+    const __m512d one = _mm512_set1_pd(1.);
+    const __m512i last = _mm512_set1_epi64(orbitSize - 1);
+    const __m512i step = _mm512_set1_epi64(1);
+
+    PerturbationLanes<8> lanes(dc_r, dc_i, count);
+
+    __m512d v_dc_r = _mm512_load_pd(lanes.dc_r);
+    __m512d v_dc_i = _mm512_load_pd(lanes.dc_i);
+    __m512d dz_r = _mm512_setzero_pd();
+    __m512d dz_i = _mm512_setzero_pd();
+    __m512d Z_r_old = _mm512_load_pd(lanes.Z_r_old);
+    __m512d Z_i_old = _mm512_load_pd(lanes.Z_i_old);
+    __m512d dz_r_old = _mm512_setzero_pd();
+    __m512d dz_i_old = _mm512_setzero_pd();
+    __m512d snapshot = _mm512_load_pd(lanes.snapshot);
+    __m512i m = _mm512_setzero_si512();
+    __m512d i = _mm512_load_pd(lanes.steps);
+    __mmask8 busy = _mm512_cmp_pd_mask(i, _mm512_setzero_pd(), _CMP_GE_OQ);
+
+    while (lanes.active > 0) {
+        // the masked gather, as gcc takes the source of the plain one for uninitialized
+        __m512d ref_r = _mm512_mask_i64gather_pd(_mm512_setzero_pd(), 0xFF, m, Z_r, 8);
+        __m512d ref_i = _mm512_mask_i64gather_pd(_mm512_setzero_pd(), 0xFF, m, Z_i, 8);
+        __m512d z_r = _mm512_add_pd(ref_r, dz_r);
+        __m512d z_i = _mm512_add_pd(ref_i, dz_i);
+        __m512d norm = _mm512_fmadd_pd(z_r, z_r, _mm512_mul_pd(z_i, z_i));
+
+        // |z - z_old| < EPS for both of the parts, the reference ones cancel out on its cycle
+        __m512d diff_r = _mm512_add_pd(_mm512_sub_pd(ref_r, Z_r_old), _mm512_sub_pd(dz_r, dz_r_old));
+        __m512d diff_i = _mm512_add_pd(_mm512_sub_pd(ref_i, Z_i_old), _mm512_sub_pd(dz_i, dz_i_old));
+        __mmask8 converged = _mm512_cmp_pd_mask(_mm512_abs_pd(diff_r), eps, _CMP_LT_OQ)
+                & _mm512_cmp_pd_mask(_mm512_abs_pd(diff_i), eps, _CMP_LT_OQ);
+
+        __mmask8 escaped = _mm512_cmp_pd_mask(norm, radius, _CMP_NLT_UQ);
+        __mmask8 finished = escaped | _mm512_cmp_pd_mask(i, limit, _CMP_NLT_UQ) | converged;
+        finished &= busy;
+
+        if (finished != 0) {
+            _mm512_store_pd(lanes.z_r, z_r);
+            _mm512_store_pd(lanes.z_i, z_i);
+            _mm512_store_pd(lanes.dz_r, dz_r);
+            _mm512_store_pd(lanes.dz_i, dz_i);
+            _mm512_store_pd(lanes.Z_r_old, Z_r_old);
+            _mm512_store_pd(lanes.Z_i_old, Z_i_old);
+            _mm512_store_pd(lanes.dz_r_old, dz_r_old);
+            _mm512_store_pd(lanes.dz_i_old, dz_i_old);
+            _mm512_store_pd(lanes.snapshot, snapshot);
+            _mm512_store_pd(lanes.steps, i);
+            _mm512_store_si512(lanes.m, m);
+
+            for (size_t lane = 0; lane < 8; ++lane) {
+                if (finished & (1 << lane)) {
+                    lanes.retire(lane, escaped & (1 << lane), iterationsCount, out);
+                }
+            }
+
+            v_dc_r = _mm512_load_pd(lanes.dc_r);
+            v_dc_i = _mm512_load_pd(lanes.dc_i);
+            dz_r = _mm512_load_pd(lanes.dz_r);
+            dz_i = _mm512_load_pd(lanes.dz_i);
+            Z_r_old = _mm512_load_pd(lanes.Z_r_old);
+            Z_i_old = _mm512_load_pd(lanes.Z_i_old);
+            dz_r_old = _mm512_load_pd(lanes.dz_r_old);
+            dz_i_old = _mm512_load_pd(lanes.dz_i_old);
+            snapshot = _mm512_load_pd(lanes.snapshot);
+            m = _mm512_load_si512(lanes.m);
+            i = _mm512_load_pd(lanes.steps);
+            busy = _mm512_cmp_pd_mask(i, _mm512_setzero_pd(), _CMP_GE_OQ);
+            continue;
+        }
+
+        __mmask8 taken = _mm512_cmp_pd_mask(i, snapshot, _CMP_EQ_OQ);
+        Z_r_old = _mm512_mask_blend_pd(taken, Z_r_old, ref_r);
+        Z_i_old = _mm512_mask_blend_pd(taken, Z_i_old, ref_i);
+        dz_r_old = _mm512_mask_blend_pd(taken, dz_r_old, dz_r);
+        dz_i_old = _mm512_mask_blend_pd(taken, dz_i_old, dz_i);
+        snapshot = _mm512_mask_add_pd(snapshot, taken, snapshot, snapshot);
+
+        // rebased lanes go on from Z[0] = 0
+        __m512d dz_norm = _mm512_fmadd_pd(dz_r, dz_r, _mm512_mul_pd(dz_i, dz_i));
+        __mmask8 rebased = _mm512_cmp_pd_mask(norm, dz_norm, _CMP_LT_OQ) | _mm512_cmpeq_epi64_mask(m, last);
+        dz_r = _mm512_mask_blend_pd(rebased, dz_r, z_r);
+        dz_i = _mm512_mask_blend_pd(rebased, dz_i, z_i);
+        ref_r = _mm512_maskz_mov_pd(~rebased, ref_r);
+        ref_i = _mm512_maskz_mov_pd(~rebased, ref_i);
+        m = _mm512_maskz_mov_epi64(~rebased, m);
+
+        __m512d t_r = _mm512_add_pd(_mm512_add_pd(ref_r, ref_r), dz_r);
+        __m512d t_i = _mm512_add_pd(_mm512_add_pd(ref_i, ref_i), dz_i);
+        __m512d dz_r_tmp = _mm512_add_pd(_mm512_fmsub_pd(t_r, dz_r, _mm512_mul_pd(t_i, dz_i)), v_dc_r);
+        dz_i = _mm512_add_pd(_mm512_fmadd_pd(t_r, dz_i, _mm512_mul_pd(t_i, dz_r)), v_dc_i);
+        dz_r = dz_r_tmp;
+
+        // idle lanes stay at the start of the orbit
+        m = _mm512_mask_add_epi64(m, busy, m, step);
+        i = _mm512_add_pd(i, one);
+    }
+}
+
+}
+
+#endif
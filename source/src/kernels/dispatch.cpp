@@ -0,0 +1,74 @@
+#include "kernels.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace mandelbrot::kernels {
+
+namespace {
+
+bool always() {
+    return true;
+}
+
+#ifdef MANDELBROT_X86
+// gcc and clang check that OS saves the wide registers too
+bool hasSSE2() {
+    return __builtin_cpu_supports("sse2");
+}
+
+bool hasAVX2() {
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+}
+
+bool hasAVX512() {
+    return __builtin_cpu_supports("avx512f");
+}
+#endif
+
+Kernel const& choose() {
+    auto const& kernels = family();
+    const char* forced = std::getenv("MANDELBROT_KERNEL");
+
+    if (forced != nullptr) {
+        for (auto const& kernel : kernels) {
+            if (std::strcmp(kernel.name, forced) != 0) {
+                continue;
+            }
+            if (kernel.supported()) {
+                return kernel;
+            }
+            std::fprintf(stderr, "kernel %s is not supported by this CPU\n", forced);
+            break;
+        }
+    }
+
+    for (auto const& kernel : kernels) {
+        if (kernel.supported()) {
+            return kernel;
+        }
+    }
+    return kernels.back(); // scalar one is always supported
+}
+
+}
+
+std::vector<Kernel> const& family() {
+    static const std::vector<Kernel> kernels = {
+#ifdef MANDELBROT_X86
+        {"avx512", runAVX512, runAVX512Single, runAVX512DoubleDouble, runAVX512Perturbation, hasAVX512},
+        {"avx2", runAVX2, runAVX2Single, runAVX2DoubleDouble, runAVX2Perturbation, hasAVX2},
+        // double-double needs FMA, which SSE2 machines usually don't have
+        {"sse2", runSSE2, runSSE2Single, runScalarDoubleDouble, runScalarPerturbation, hasSSE2},
+#endif
+        {"scalar", runScalar, runScalarSingle, runScalarDoubleDouble, runScalarPerturbation, always},
+    };
+    return kernels;
+}
+
+Kernel const& active() {
+    static Kernel const& kernel = choose();
+    return kernel;
+}
+
+}
@@ -0,0 +1,199 @@
+#include "kernels.h"
+#include "doubledouble.h"
+#include <cmath>
+
+namespace mandelbrot::kernels {
+
+namespace {
+
+template <typename T>
+Escape approxStepsPower2(T z_r, T z_i, size_t initialSteps, T c_r, T c_i, size_t iterationsCount, T EPS) {
+    // welcome optimizations
+
+    // cardioid check
+    // this optimization helps to speed up the launch by 60 times.
+    // it covers major part of mandelbrot, but absolutely useless
+    // when moving away from the cardioid part of mandelbrot.
+    // (replaced by periodicity checking)
+
+    // one of reviewed optimization was hyperbolic components check
+    // that included recursive calculating derivative
+    // unfortunately, it has worked on thin edge only (< 10% pixels covered)
+    // providing sometimes 2 times slower computing
+    // it is also can't be used with iterations counting (no coloring)
+    // i may be wrong.
+
+    // basic check looks like this:
+
+    /*std::complex<double> z = 0;
+    for (size_t i = 0; i < iterationsCount; ++i) {
+        if (z.imag() * z.imag() + z.real() * z.real() >= 4.) {
+            return i; // outside
+        }
+        z = z * z + c;
+    }
+    return 0;*/
+
+    // let's reduce muls count
+    // let's also check if the calculating point is in a period set or converge
+
+    T z_r_old = z_r;
+    T z_i_old = z_i;
+    T z_r_sqr = z_r * z_r;
+    T z_i_sqr = z_i * z_i;
+    size_t period = 0;
+
+    for (size_t i = initialSteps; i < iterationsCount; ++i) {
+        if (z_r_sqr + z_i_sqr >= 4.) {
+            return Escape::outside(i, z_r_sqr + z_i_sqr); // outside
+        }
+
+        T z_r_tmp = z_r_sqr - z_i_sqr + c_r;
+        z_i = (2 * z_r) * z_i + c_i;
+        z_r = z_r_tmp;
+        z_r_sqr = z_r * z_r;
+        z_i_sqr = z_i * z_i;
+
+        // the escape at the next step goes first, as the SIMD kernels check both at once
+        if (std::abs(z_r - z_r_old) < EPS && std::abs(z_i - z_i_old) < EPS && z_r_sqr + z_i_sqr < 4.) {
+            return Escape::converged(iterationsCount, i + 1); // if not outside, but converges, then inside
+        }
+
+        ++period;
+        if (period > PERIODICITY_CHECK_THRESHOLD) {
+            period = 0;
+            z_r_old = z_r;
+            z_i_old = z_i;
+        }
+    }
+    return Escape::inside(iterationsCount);
+}
+
+// approxStepsPower2 in double-double, periodicity checking is the same
+Escape approxStepsDoubleDouble(DoubleDouble c_r, DoubleDouble c_i, size_t iterationsCount, double EPS) {
+    DoubleDouble z_r, z_i, z_r_old, z_i_old;
+    DoubleDouble z_r_sqr, z_i_sqr;
+    size_t period = 0;
+
+    for (size_t i = 0; i < iterationsCount; ++i) {
+        if (z_r_sqr.hi + z_i_sqr.hi >= 4.) {
+            return Escape::outside(i, z_r_sqr.hi + z_i_sqr.hi); // outside
+        }
+
+        DoubleDouble z_r_tmp = z_r_sqr - z_i_sqr + c_r;
+        z_i = z_r * z_i;
+        z_i = {2 * z_i.hi, 2 * z_i.lo};
+        z_i = z_i + c_i;
+        z_r = z_r_tmp;
+        z_r_sqr = z_r.sqr();
+        z_i_sqr = z_i.sqr();
+
+        // hi parts are close there, so their difference is exact
+        double diff_r = (z_r.hi - z_r_old.hi) + (z_r.lo - z_r_old.lo);
+        double diff_i = (z_i.hi - z_i_old.hi) + (z_i.lo - z_i_old.lo);
+        if (std::abs(diff_r) < EPS && std::abs(diff_i) < EPS && z_r_sqr.hi + z_i_sqr.hi < 4.) {
+            return Escape::converged(iterationsCount, i + 1); // if not outside, but converges, then inside
+        }
+
+        ++period;
+        if (period > PERIODICITY_CHECK_THRESHOLD) {
+            period = 0;
+            z_r_old = z_r;
+            z_i_old = z_i;
+        }
+    }
+    return Escape::inside(iterationsCount);
+}
+
+}
+
+Escape approxStepsPower2(double z_r, double z_i, size_t initialSteps,
+                         double c_r, double c_i, size_t iterationsCount, double EPS) {
+    return approxStepsPower2<double>(z_r, z_i, initialSteps, c_r, c_i, iterationsCount, EPS);
+}
+
+void runScalar(double const* c_r, double const* c_i, size_t count,
+               size_t iterationsCount, double EPS, Escape* out) {
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = approxStepsPower2(0, 0, 0, c_r[i], c_i[i], iterationsCount, EPS);
+    }
+}
+
+void runScalarSingle(double const* c_r, double const* c_i, size_t count,
+                     size_t iterationsCount, double EPS, Escape* out) {
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = approxStepsPower2<float>(0, 0, 0, c_r[i], c_i[i], iterationsCount, EPS);
+    }
+}
+
+void runScalarDoubleDouble(double const* c_r, double const* c_r_lo, double const* c_i, double const* c_i_lo,
+                           size_t count, size_t iterationsCount, double EPS, Escape* out) {
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = approxStepsDoubleDouble({c_r[i], c_r_lo[i]}, {c_i[i], c_i_lo[i]}, iterationsCount, EPS);
+    }
+}
+
+/*
+ * Glitch detection and rebasing (Zhuoran's method): when the pixel orbit comes closer to zero
+ * than to the reference one, the delta loses precision. Then dz = z and the reference orbit starts
+ * from its beginning, because Z[0] = 0. The same happens when the reference orbit escaped before the pixel,
+ * so one reference serves the whole frame.
+ *
+ * Periodicity checking compares z = Z + dz with the snapshot by the parts, so the difference is exact
+ * while the point follows the cycle of the reference, as in the interior of a minibrot.
+ * Cycles of the deep minibrots are much longer than PERIODICITY_CHECK_THRESHOLD, so the snapshots
+ * are taken at the powers of two steps, and any cycle is found once they are that far apart.
+ */
+Escape perturbedSteps(double const* Z_r, double const* Z_i, size_t orbitSize, double dz_r, double dz_i,
+                      double dc_r, double dc_i, size_t i, size_t m, size_t iterationsCount, double EPS) {
+    const size_t last = orbitSize - 1;
+    double Z_r_old = INFINITY;
+    double Z_i_old = INFINITY;
+    double dz_r_old = 0;
+    double dz_i_old = 0;
+
+    for (; i < iterationsCount; ++i) {
+        double z_r = Z_r[m] + dz_r;
+        double z_i = Z_i[m] + dz_i;
+        double norm = z_r * z_r + z_i * z_i;
+
+        if (norm >= 4.) {
+            return Escape::outside(i, norm);
+        }
+
+        if (std::abs((Z_r[m] - Z_r_old) + (dz_r - dz_r_old)) < EPS
+                && std::abs((Z_i[m] - Z_i_old) + (dz_i - dz_i_old)) < EPS) {
+            return Escape::converged(iterationsCount, i);
+        }
+        if (i != 0 && (i & (i - 1)) == 0) {
+            Z_r_old = Z_r[m];
+            Z_i_old = Z_i[m];
+            dz_r_old = dz_r;
+            dz_i_old = dz_i;
+        }
+
+        if (m == last || norm < dz_r * dz_r + dz_i * dz_i) {
+            dz_r = z_r;
+            dz_i = z_i;
+            m = 0;
+        }
+
+        double t_r = 2 * Z_r[m] + dz_r;
+        double t_i = 2 * Z_i[m] + dz_i;
+        double dz_r_tmp = t_r * dz_r - t_i * dz_i + dc_r;
+        dz_i = t_r * dz_i + t_i * dz_r + dc_i;
+        dz_r = dz_r_tmp;
+        ++m;
+    }
+    return Escape::inside(iterationsCount);
+}
+
+void runScalarPerturbation(double const* Z_r, double const* Z_i, size_t orbitSize,
+                           double const* dc_r, double const* dc_i, size_t count,
+                           size_t iterationsCount, double EPS, Escape* out) {
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = perturbedSteps(Z_r, Z_i, orbitSize, 0, 0, dc_r[i], dc_i[i], 0, 0, iterationsCount, EPS);
+    }
+}
+
+}
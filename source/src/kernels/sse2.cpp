@@ -0,0 +1,171 @@
+#include "kernels.h"
+#include "kernellanes.h"
+
+#ifdef MANDELBROT_X86
+#include <emmintrin.h>
+
+namespace mandelbrot::kernels {
+
+KERNEL_TARGET("sse2")
+void runSSE2(double const* c_r, double const* c_i, size_t count,
+             size_t iterationsCount, double EPS, Escape* out) {
+    // the same lanes refilling as in runAVX2, but two lanes wide and without fma
+
+    const __m128d radius = _mm_set1_pd(4.);
+    const __m128d limit = _mm_set1_pd(iterationsCount);
+    const __m128d eps = _mm_set1_pd(EPS);
+    const __m128d one = _mm_set1_pd(1.);
+    const __m128d signMask = _mm_set1_pd(-0.);
+
+    Lanes<double, 2> lanes(c_r, c_i, count);
+
+    __m128d v_c_r = _mm_load_pd(lanes.c_r);
+    __m128d v_c_i = _mm_load_pd(lanes.c_i);
+    __m128d z_r = _mm_setzero_pd();
+    __m128d z_i = _mm_setzero_pd();
+    __m128d z_r_old = _mm_setzero_pd();
+    __m128d z_i_old = _mm_setzero_pd();
+    __m128d i = _mm_load_pd(lanes.steps);
+    __m128d busy = _mm_cmpge_pd(i, _mm_setzero_pd());
+    __m128d converged = _mm_setzero_pd();
+    size_t period = 0;
+
+    while (lanes.active > 0) {
+        __m128d z_i_sqr = _mm_mul_pd(z_i, z_i);
+        __m128d z_r_sqr = _mm_mul_pd(z_r, z_r);
+        __m128d check = _mm_add_pd(z_r_sqr, z_i_sqr);
+
+        __m128d escaped = _mm_cmpnlt_pd(check, radius);
+        __m128d finished = _mm_or_pd(escaped, _mm_cmpnlt_pd(i, limit));
+        finished = _mm_and_pd(_mm_or_pd(finished, converged), busy);
+        int finishedMask = _mm_movemask_pd(finished);
+
+        if (finishedMask != 0) {
+            int escapedMask = _mm_movemask_pd(escaped);
+
+            _mm_store_pd(lanes.z_r, z_r);
+            _mm_store_pd(lanes.z_i, z_i);
+            _mm_store_pd(lanes.z_r_old, z_r_old);
+            _mm_store_pd(lanes.z_i_old, z_i_old);
+            _mm_store_pd(lanes.steps, i);
+
+            for (size_t lane = 0; lane < 2; ++lane) {
+                if (finishedMask & (1 << lane)) {
+                    lanes.retire(lane, escapedMask & (1 << lane), iterationsCount, out);
+                }
+            }
+
+            v_c_r = _mm_load_pd(lanes.c_r);
+            v_c_i = _mm_load_pd(lanes.c_i);
+            z_r = _mm_load_pd(lanes.z_r);
+            z_i = _mm_load_pd(lanes.z_i);
+            z_r_old = _mm_load_pd(lanes.z_r_old);
+            z_i_old = _mm_load_pd(lanes.z_i_old);
+            i = _mm_load_pd(lanes.steps);
+            busy = _mm_cmpge_pd(i, _mm_setzero_pd());
+            converged = _mm_setzero_pd();
+            continue;
+        }
+
+        __m128d z_r_tmp = _mm_add_pd(_mm_sub_pd(z_r_sqr, z_i_sqr), v_c_r);
+        z_i = _mm_add_pd(_mm_mul_pd(_mm_add_pd(z_r, z_r), z_i), v_c_i);
+        z_r = z_r_tmp;
+        i = _mm_add_pd(i, one);
+
+        // |z - z_old| < EPS for both of the parts
+        __m128d diff_r = _mm_andnot_pd(signMask, _mm_sub_pd(z_r, z_r_old));
+        __m128d diff_i = _mm_andnot_pd(signMask, _mm_sub_pd(z_i, z_i_old));
+        converged = _mm_and_pd(_mm_cmplt_pd(diff_r, eps), _mm_cmplt_pd(diff_i, eps));
+
+        ++period;
+        if (period > PERIODICITY_CHECK_THRESHOLD) {
+            period = 0;
+            z_r_old = z_r;
+            z_i_old = z_i;
+        }
+    }
+}
+
+KERNEL_TARGET("sse2")
+void runSSE2Single(double const* c_r, double const* c_i, size_t count,
+                   size_t iterationsCount, double EPS, Escape* out) {
+    // runSSE2 in single precision: four lanes wide
+
+    const __m128 radius = _mm_set1_ps(4.f);
+    const __m128 limit = _mm_set1_ps(static_cast<float>(iterationsCount));
+    const __m128 eps = _mm_set1_ps(static_cast<float>(EPS));
+    const __m128 one = _mm_set1_ps(1.f);
+    const __m128 signMask = _mm_set1_ps(-0.f);
+
+    Lanes<float, 4> lanes(c_r, c_i, count);
+
+    __m128 v_c_r = _mm_load_ps(lanes.c_r);
+    __m128 v_c_i = _mm_load_ps(lanes.c_i);
+    __m128 z_r = _mm_setzero_ps();
+    __m128 z_i = _mm_setzero_ps();
+    __m128 z_r_old = _mm_setzero_ps();
+    __m128 z_i_old = _mm_setzero_ps();
+    __m128 i = _mm_load_ps(lanes.steps);
+    __m128 busy = _mm_cmpge_ps(i, _mm_setzero_ps());
+    __m128 converged = _mm_setzero_ps();
+    size_t period = 0;
+
+    while (lanes.active > 0) {
+        __m128 z_i_sqr = _mm_mul_ps(z_i, z_i);
+        __m128 z_r_sqr = _mm_mul_ps(z_r, z_r);
+        __m128 check = _mm_add_ps(z_r_sqr, z_i_sqr);
+
+        __m128 escaped = _mm_cmpnlt_ps(check, radius);
+        __m128 finished = _mm_or_ps(escaped, _mm_cmpnlt_ps(i, limit));
+        finished = _mm_and_ps(_mm_or_ps(finished, converged), busy);
+        int finishedMask = _mm_movemask_ps(finished);
+
+        if (finishedMask != 0) {
+            int escapedMask = _mm_movemask_ps(escaped);
+
+            _mm_store_ps(lanes.z_r, z_r);
+            _mm_store_ps(lanes.z_i, z_i);
+            _mm_store_ps(lanes.z_r_old, z_r_old);
+            _mm_store_ps(lanes.z_i_old, z_i_old);
+            _mm_store_ps(lanes.steps, i);
+
+            for (size_t lane = 0; lane < 4; ++lane) {
+                if (finishedMask & (1 << lane)) {
+                    lanes.retire(lane, escapedMask & (1 << lane), iterationsCount, out);
+                }
+            }
+
+            v_c_r = _mm_load_ps(lanes.c_r);
+            v_c_i = _mm_load_ps(lanes.c_i);
+            z_r = _mm_load_ps(lanes.z_r);
+            z_i = _mm_load_ps(lanes.z_i);
+            z_r_old = _mm_load_ps(lanes.z_r_old);
+            z_i_old = _mm_load_ps(lanes.z_i_old);
+            i = _mm_load_ps(lanes.steps);
+            busy = _mm_cmpge_ps(i, _mm_setzero_ps());
+            converged = _mm_setzero_ps();
+            continue;
+        }
+
+        __m128 z_r_tmp = _mm_add_ps(_mm_sub_ps(z_r_sqr, z_i_sqr), v_c_r);
+        z_i = _mm_add_ps(_mm_mul_ps(_mm_add_ps(z_r, z_r), z_i), v_c_i);
+        z_r = z_r_tmp;
+        i = _mm_add_ps(i, one);
+
+        // |z - z_old| < EPS for both of the parts
+        __m128 diff_r = _mm_andnot_ps(signMask, _mm_sub_ps(z_r, z_r_old));
+        __m128 diff_i = _mm_andnot_ps(signMask, _mm_sub_ps(z_i, z_i_old));
+        converged = _mm_and_ps(_mm_cmplt_ps(diff_r, eps), _mm_cmplt_ps(diff_i, eps));
+
+        ++period;
+        if (period > PERIODICITY_CHECK_THRESHOLD) {
+            period = 0;
+            z_r_old = z_r;
+            z_i_old = z_i;
+        }
+    }
+}
+
+}
+
+#endif
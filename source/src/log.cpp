@@ -0,0 +1,27 @@
+#include "log.h"
+
+namespace mandelbrot {
+
+namespace {
+
+LogHandler handler;
+
+}
+
+void setLogHandler(LogHandler logHandler) {
+    handler = std::move(logHandler);
+}
+
+DebugLine::DebugLine() : enabled(static_cast<bool>(handler)) {}
+
+DebugLine::~DebugLine() {
+    if (enabled) {
+        handler(stream.str());
+    }
+}
+
+DebugLine debug() {
+    return {};
+}
+
+}
@@ -1,11 +1,29 @@
 #include "mainwindow.h"
+#include "trace.h"
 
 #include <QApplication>
+#include <QDebug>
+#include <cstdlib>
 
 int main(int argc, char *argv[])
 {
-    QApplication a(argc, argv);
-    MainWindow w;
-    w.show();
-    return a.exec();
+    // the timeline of the whole run goes to the file named by MANDELBROT_TRACE
+    const char* trace = std::getenv("MANDELBROT_TRACE");
+    mandelbrot::trace::setThreadName("GUI");
+    if (trace != nullptr) {
+        mandelbrot::trace::start();
+    }
+
+    int result;
+    {
+        QApplication a(argc, argv);
+        MainWindow w;
+        w.show();
+        result = a.exec();
+    }
+
+    if (trace != nullptr && !mandelbrot::trace::stop(trace)) {
+        qWarning() << "can't write the trace to" << trace;
+    }
+    return result;
 }
@@ -0,0 +1,120 @@
+#include "perturbation.h"
+#include "kernels.h"
+#include <cmath>
+
+namespace mandelbrot::perturbation {
+
+namespace {
+
+// deltas larger than 2^DOUBLE_DELTA_MIN_EXPONENT are iterated in double.
+// smaller ones would give denormal dz^2, which is awfully slow on x86.
+const int64_t DOUBLE_DELTA_MIN_EXPONENT = -500;
+
+Escape stepsExtended(Orbit const& orbit, double u_r, double u_i, FloatExp scale, size_t iterationsCount, double EPS) {
+    // while |dz| < 2^DOUBLE_DELTA_MIN_EXPONENT, dz^2 is negligible, so the iteration is linear:
+    // dz[n+1] = 2 * Z[n] * dz[n] + dc. hence w = dz / scale is iterated in plain double
+    // with dc / scale = u, and z = Z + dz is as good as Z.
+
+    const double* Z_r = orbit.z_r.data();
+    const double* Z_i = orbit.z_i.data();
+    const size_t last = orbit.z_r.size() - 1;
+    const double bound = std::ldexp(1., static_cast<int>(DOUBLE_DELTA_MIN_EXPONENT - scale.exponent));
+
+    double w_r = 0;
+    double w_i = 0;
+    size_t m = 0;
+
+    // the same periodicity check as in kernels::perturbedSteps. the pixels are that small here,
+    // that z is close to the snapshot only when Z is the same, and then w is less than a pixel away
+    double Z_r_old = INFINITY;
+    double Z_i_old = INFINITY;
+    double w_r_old = 0;
+    double w_i_old = 0;
+
+    for (size_t i = 0; i < iterationsCount; ++i) {
+        // once the delta has grown (or has to be rebased), double is enough for the rest of the orbit
+        if (std::abs(w_r) > bound || std::abs(w_i) > bound || m == last) {
+            return kernels::perturbedSteps(Z_r, Z_i, orbit.z_r.size(),
+                                           (scale * w_r).toDouble(), (scale * w_i).toDouble(),
+                                           (scale * u_r).toDouble(), (scale * u_i).toDouble(),
+                                           i, m, iterationsCount, EPS);
+        }
+
+        double norm = Z_r[m] * Z_r[m] + Z_i[m] * Z_i[m];
+        if (norm >= 4.) {
+            return Escape::outside(i, norm);
+        }
+
+        if (Z_r[m] == Z_r_old && Z_i[m] == Z_i_old && std::abs(w_r - w_r_old) < 1 && std::abs(w_i - w_i_old) < 1) {
+            return Escape::converged(iterationsCount, i);
+        }
+        if (i != 0 && (i & (i - 1)) == 0) {
+            Z_r_old = Z_r[m];
+            Z_i_old = Z_i[m];
+            w_r_old = w_r;
+            w_i_old = w_i;
+        }
+
+        double w_r_tmp = 2 * (Z_r[m] * w_r - Z_i[m] * w_i) + u_r;
+        w_i = 2 * (Z_r[m] * w_i + Z_i[m] * w_r) + u_i;
+        w_r = w_r_tmp;
+        ++m;
+    }
+    return Escape::inside(iterationsCount);
+}
+
+}
+
+bool Orbit::matches(BigFixed const& r, BigFixed const& i, size_t count) const {
+    return iterationsCount == count && c_r == r && c_i == i
+            && c_r.precision() == r.precision() && !z_r.empty();
+}
+
+void Orbit::compute(BigFixed const& r, BigFixed const& i, size_t count) {
+    c_r = r;
+    c_i = i;
+    iterationsCount = count;
+
+    z_r.assign(1, 0);
+    z_i.assign(1, 0);
+
+    BigFixed x(0., r.precision());
+    BigFixed y(0., r.precision());
+
+    // stops right after the escape, pixels are rebased there
+    for (size_t n = 0; n < count; ++n) {
+        BigFixed x_sqr = x * x;
+        BigFixed y_sqr = y * y;
+
+        if ((x_sqr + y_sqr).toDouble() >= 4.) {
+            break;
+        }
+
+        y = (x + x) * y + c_i;
+        x = x_sqr - y_sqr + c_r;
+
+        z_r.push_back(x.toDouble());
+        z_i.push_back(y.toDouble());
+    }
+}
+
+void run(Orbit const& orbit, double* u_r, double* u_i, size_t count,
+         FloatExp scale, size_t iterationsCount, double EPS, Escape* out) {
+    const double doubleScale = scale.toDouble();
+
+    // the smallest pixel offset is a half, so its delta has to be a normal double
+    if (scale.exponent > DOUBLE_DELTA_MIN_EXPONENT) {
+        for (size_t i = 0; i < count; ++i) {
+            u_r[i] *= doubleScale;
+            u_i[i] *= doubleScale;
+        }
+        kernels::active().runPerturbation(orbit.z_r.data(), orbit.z_i.data(), orbit.z_r.size(),
+                                          u_r, u_i, count, iterationsCount, EPS, out);
+    } else {
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = stepsExtended(orbit, u_r[i], u_i[i], scale, iterationsCount, EPS);
+        }
+    }
+}
+
+}
@@ -0,0 +1,248 @@
+#include "engine.h"
+#include "mandelbrot.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+
+const char* USAGE =
+        "usage: mandelbrot_scalingbench [options]\n"
+        "  --threads LIST    worker counts like 1,2,4, up to the cores count, all of them by default\n"
+        "  --tiles LIST      scheduled tile sizes, multiples of 8 up to 64, 16,32,64 by default\n"
+        "  --sizes LIST      frame sizes like 1280x720, 640x480,1280x720,1920x1080 by default\n"
+        "  --scene S         initial, seahorse or deep, initial by default\n"
+        "  --repeats N       timed frames of every case, 3 by default\n";
+
+// places of the plane at a fixed pixel size, so larger frames show more of it, as a larger window does
+struct Scene {
+    const char* name;
+    const char* x;
+    const char* y;
+    double scale; // plane units per pixel
+};
+
+const Scene SCENES[] = {
+    {"initial", "-0.5", "0", mandelbrot::INITIAL_SCALE}, // what the viewport opens with
+    {"seahorse", "-0.75", "0.1", 2e-6}, // boundary everywhere, single precision no more
+    {"deep", "-0.743643887037151", "0.131825904205330", 1e-13}, // double-double
+};
+
+struct Options {
+    std::vector<size_t> threads;
+    std::vector<size_t> tiles = {16, 32, 64};
+    std::vector<mandelbrot::Size> sizes = {{640, 480}, {1280, 720}, {1920, 1080}};
+    std::string scene = "initial";
+    size_t repeats = 3;
+};
+
+struct Latency {
+    double previewMs; // the first thing the viewport could show
+    double frameMs; // the complete precise frame
+};
+
+bool parseCount(std::string const& text, size_t& value) {
+    char* end;
+    value = std::strtoul(text.c_str(), &end, 10);
+    return !text.empty() && *end == '\0' && value > 0;
+}
+
+// comma separated items, every one of them parsed
+template <typename T, typename Parse>
+bool parseList(std::string const& text, std::vector<T>& values, Parse parse) {
+    values.clear();
+    size_t from = 0;
+    for (;;) {
+        size_t comma = text.find(',', from);
+        T value;
+        if (!parse(text.substr(from, comma - from), value)) {
+            return false;
+        }
+        values.push_back(value);
+        if (comma == std::string::npos) {
+            return true;
+        }
+        from = comma + 1;
+    }
+}
+
+bool parseSize(std::string const& text, mandelbrot::Size& size) {
+    size_t x = text.find('x');
+    size_t width, height;
+    if (x == std::string::npos || !parseCount(text.substr(0, x), width) || !parseCount(text.substr(x + 1), height)) {
+        return false;
+    }
+    size = mandelbrot::Size(static_cast<int>(width), static_cast<int>(height));
+    return true;
+}
+
+// the engine takes the tiles aligned to the blocks of every stage only
+bool parseTile(std::string const& text, size_t& value) {
+    return parseCount(text, value) && value % mandelbrot::MIN_TILE_SIZE == 0 && value <= mandelbrot::TILE_SIZE;
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+
+        if (arg == "--threads" && hasValue) {
+            if (!parseList(argv[++i], options.threads, parseCount)
+                    || *std::max_element(options.threads.begin(), options.threads.end()) > mandelbrot::MAX_THREADS_COUNT) {
+                return false;
+            }
+        } else if (arg == "--tiles" && hasValue) {
+            if (!parseList(argv[++i], options.tiles, parseTile)) {
+                return false;
+            }
+        } else if (arg == "--sizes" && hasValue) {
+            if (!parseList(argv[++i], options.sizes, parseSize)) {
+                return false;
+            }
+        } else if (arg == "--scene" && hasValue) {
+            options.scene = argv[++i];
+        } else if (arg == "--repeats" && hasValue) {
+            if (!parseCount(argv[++i], options.repeats)) {
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * One frame requested from a new engine, as the viewport requests it, and taken as the viewport takes it.
+ * The engine is new, so nothing is carried over from the previous frame or the tile cache,
+ * and its workers are started as they are for the first frame of the window.
+ */
+Latency renderFrame(Scene const& scene, mandelbrot::Size size, mandelbrot::RendererSettings const& settings) {
+    using namespace mandelbrot;
+
+    Engine engine;
+    engine.setSettings(settings);
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool published = false;
+    engine.setFrameCallback([&] {
+        std::lock_guard<std::mutex> lock(mutex);
+        published = true;
+        cv.notify_one();
+    });
+
+    const FloatExp scale(scene.scale);
+    const double scaleLog = 1 + std::log2(INITIAL_SCALE) - scale.log2();
+    BigPos center;
+    BigFixed::parse(scene.x, BigFixed::limbsFor(scale), center.x);
+    BigFixed::parse(scene.y, BigFixed::limbsFor(scale), center.y);
+
+    auto start = std::chrono::steady_clock::now();
+    engine.request(1, center, size, scale, scaleLog, false);
+
+    Latency latency = {-1, -1};
+    FrameExchange& precise = engine.frames(false);
+    FrameExchange& overview = engine.frames(true);
+    while (latency.frameMs < 0) {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&] { return published; });
+        published = false;
+        lock.unlock();
+
+        // either one is drawn, whichever comes first
+        const bool overviewTaken = overview.take();
+        const bool preciseTaken = precise.take();
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        if ((overviewTaken || preciseTaken) && latency.previewMs < 0) {
+            latency.previewMs = elapsed.count();
+        }
+        if (preciseTaken && precise.info().complete) {
+            latency.frameMs = elapsed.count();
+        }
+    }
+
+    engine.stop();
+    engine.wait();
+    return latency;
+}
+
+double median(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    const size_t middle = values.size() / 2;
+    return values.size() % 2 ? values[middle] : (values[middle - 1] + values[middle]) / 2;
+}
+
+}
+
+/*
+ * Latency of the whole frames by the workers count, tile size and frame size: the time to the first
+ * preview and to the complete frame, from the request to the take, both medians of the repeats.
+ * Speedup and efficiency are of the complete frames, relative to the first workers count of the list.
+ * The engine is driven directly, as the GUI renderer only forwards to it, so no display is needed.
+ */
+int main(int argc, char** argv) {
+    using namespace mandelbrot;
+
+    Options options;
+    for (size_t threads = 1; threads <= MAX_THREADS_COUNT; ++threads) {
+        options.threads.push_back(threads);
+    }
+    if (!parseOptions(argc, argv, options)) {
+        std::fputs(USAGE, stderr);
+        return 2;
+    }
+
+    auto scene = std::find_if(std::begin(SCENES), std::end(SCENES), [&](Scene const& s) {
+        return options.scene == s.name;
+    });
+    if (scene == std::end(SCENES)) {
+        std::fputs(USAGE, stderr);
+        return 2;
+    }
+
+    RendererSettings settings;
+    settings.threadsCountAuto = false;
+    settings.tileCacheMegabytes = 0;
+
+    std::printf("scene %s, %zu cores, kernel %s\n", scene->name, MAX_THREADS_COUNT, kernels::active().name);
+
+    for (Size size : options.sizes) {
+        for (size_t tile : options.tiles) {
+            settings.tileSize = tile;
+            std::printf("\n%dx%d, %zu px tiles\n", size.width(), size.height(), tile);
+            std::printf("%8s %12s %12s %10s %11s\n", "threads", "preview ms", "frame ms", "speedup", "efficiency");
+
+            double baseMs = 0;
+            for (size_t threads : options.threads) {
+                settings.threadsCount = threads;
+
+                // the first frame pays for the page faults of the buffers, it is not counted
+                renderFrame(*scene, size, settings);
+                std::vector<double> preview, frame;
+                for (size_t i = 0; i < options.repeats; ++i) {
+                    Latency latency = renderFrame(*scene, size, settings);
+                    preview.push_back(latency.previewMs);
+                    frame.push_back(latency.frameMs);
+                }
+
+                const double frameMs = median(frame);
+                if (baseMs == 0) {
+                    baseMs = frameMs;
+                }
+                const double speedup = baseMs / frameMs;
+                const double efficiency = speedup * options.threads.front() / threads;
+                std::printf("%8zu %12.2f %12.2f %10.2f %10.0f%%\n",
+                            threads, median(preview), frameMs, speedup, 100 * efficiency);
+                std::fflush(stdout);
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,195 @@
+#include "tilecache.h"
+#include <algorithm>
+
+namespace mandelbrot {
+
+namespace {
+
+const size_t TILE_BYTES = TILE_SIZE * TILE_SIZE * sizeof(Escape);
+
+}
+
+void TileCache::setBudget(size_t bytes) {
+    budget = bytes;
+    evict();
+}
+
+bool TileCache::origin(FloatExp scale, size_t iterationsCount, BigPos& origin) const {
+    Level const* level = find(scale, iterationsCount);
+    if (level == nullptr) {
+        return false;
+    }
+    origin = level->origin;
+    return true;
+}
+
+void TileCache::setOrigin(FloatExp scale, size_t iterationsCount, BigPos const& origin) {
+    Level const* old = find(scale, iterationsCount);
+    const uint64_t oldId = old != nullptr ? old->id : nextLevelId;
+    if (old != nullptr) {
+        for (auto it = entries.begin(); it != entries.end();) {
+            if (it->key.level == oldId) {
+                index.erase(it->key);
+                it = entries.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    // the old grid of this level is gone as well as the empty levels
+    levels.erase(std::remove_if(levels.begin(), levels.end(), [oldId](Level const& level) {
+        return level.id == oldId || level.tiles == 0;
+    }), levels.end());
+
+    levels.push_back({scale, iterationsCount, origin, nextLevelId++, 0});
+}
+
+size_t TileCache::load(FloatExp scale, size_t iterationsCount, int64_t x, int64_t y,
+                       size_t width, size_t height, Escape* pixels) {
+    Level const* level = find(scale, iterationsCount);
+    if (level == nullptr || width == 0 || height == 0) {
+        return 0;
+    }
+
+    const int64_t tileSize = TILE_SIZE;
+    const int64_t x1 = x + width;
+    const int64_t y1 = y + height;
+    size_t loaded = 0;
+
+    for (int64_t ty = floorDiv(y, tileSize); ty * tileSize < y1; ++ty) {
+        for (int64_t tx = floorDiv(x, tileSize); tx * tileSize < x1; ++tx) {
+            ++lookups;
+            std::vector<Escape> const* tile = get({level->id, tx, ty});
+            if (tile == nullptr) {
+                continue;
+            }
+            ++hits;
+
+            // the tile part inside of the frame
+            int64_t from_x = std::max(x, tx * tileSize);
+            int64_t to_x = std::min(x1, (tx + 1) * tileSize);
+            int64_t from_y = std::max(y, ty * tileSize);
+            int64_t to_y = std::min(y1, (ty + 1) * tileSize);
+
+            for (int64_t j = from_y; j < to_y; ++j) {
+                Escape const* src = tile->data() + (j - ty * tileSize) * tileSize;
+                Escape* dst = pixels + (j - y) * width;
+
+                for (int64_t i = from_x; i < to_x; ++i) {
+                    Escape value = src[i - tx * tileSize];
+                    if (!dst[i - x].known() && value.known()) {
+                        dst[i - x] = value;
+                        ++loaded;
+                    }
+                }
+            }
+        }
+    }
+    return loaded;
+}
+
+void TileCache::store(FloatExp scale, size_t iterationsCount, int64_t x, int64_t y,
+                      size_t width, size_t height, Escape const* pixels) {
+    Level const* level = find(scale, iterationsCount);
+    if (level == nullptr || budget < TILE_BYTES) {
+        return;
+    }
+
+    const int64_t tileSize = TILE_SIZE;
+    const int64_t x1 = x + width;
+    const int64_t y1 = y + height;
+    const uint64_t id = level->id;
+
+    for (int64_t ty = floorDiv(y, tileSize); ty * tileSize < y1; ++ty) {
+        for (int64_t tx = floorDiv(x, tileSize); tx * tileSize < x1; ++tx) {
+            int64_t from_x = std::max(x, tx * tileSize);
+            int64_t to_x = std::min(x1, (tx + 1) * tileSize);
+            int64_t from_y = std::max(y, ty * tileSize);
+            int64_t to_y = std::min(y1, (ty + 1) * tileSize);
+
+            // dropped frames leave whole tiles unknown, they are not worth an entry
+            bool known = false;
+            for (int64_t j = from_y; j < to_y && !known; ++j) {
+                Escape const* src = pixels + (j - y) * width;
+                known = std::any_of(src + (from_x - x), src + (to_x - x), [](Escape const& value) {
+                    return value.known();
+                });
+            }
+            if (!known) {
+                continue;
+            }
+
+            Key key = {id, tx, ty};
+            std::vector<Escape>* tile = get(key);
+            if (tile == nullptr) {
+                entries.push_front({key, std::vector<Escape>(TILE_SIZE * TILE_SIZE)});
+                index[key] = entries.begin();
+                ++find(id)->tiles;
+                tile = &entries.front().pixels;
+            }
+
+            for (int64_t j = from_y; j < to_y; ++j) {
+                Escape const* src = pixels + (j - y) * width;
+                Escape* dst = tile->data() + (j - ty * tileSize) * tileSize;
+
+                for (int64_t i = from_x; i < to_x; ++i) {
+                    if (src[i - x].known()) {
+                        dst[i - tx * tileSize] = src[i - x];
+                    }
+                }
+            }
+        }
+    }
+
+    evict();
+}
+
+TileCacheStats TileCache::stats() const {
+    return {lookups, hits, entries.size(), entries.size() * TILE_BYTES};
+}
+
+TileCache::Level const* TileCache::find(FloatExp scale, size_t iterationsCount) const {
+    for (Level const& level : levels) {
+        if (level.scale == scale && level.iterationsCount == iterationsCount) {
+            return &level;
+        }
+    }
+    return nullptr;
+}
+
+TileCache::Level* TileCache::find(uint64_t id) {
+    for (Level& level : levels) {
+        if (level.id == id) {
+            return &level;
+        }
+    }
+    return nullptr;
+}
+
+// looks the tile up and marks it as the most recently used one
+std::vector<Escape>* TileCache::get(Key const& key) {
+    auto it = index.find(key);
+    if (it == index.end()) {
+        return nullptr;
+    }
+    entries.splice(entries.begin(), entries, it->second);
+    return &it->second->pixels;
+}
+
+void TileCache::evict() {
+    while (!entries.empty() && entries.size() * TILE_BYTES > budget) {
+        Entry const& entry = entries.back();
+        if (Level* level = find(entry.key.level)) {
+            --level->tiles;
+        }
+        index.erase(entry.key);
+        entries.pop_back();
+    }
+}
+
+int64_t TileCache::floorDiv(int64_t a, int64_t b) {
+    return a / b - (a % b < 0 ? 1 : 0);
+}
+
+}
@@ -0,0 +1,81 @@
+#include "tilescheduler.h"
+#include <algorithm>
+
+namespace mandelbrot {
+
+void TileScheduler::reset(size_t width, size_t height, size_t tileSize, size_t count) {
+    if (count != workersCount) {
+        workersCount = count;
+        queues.reset(new Queue[count]);
+    }
+    workers.assign(count, WorkerStats());
+
+    size_t columns = (width + tileSize - 1) / tileSize;
+    size_t rows = (height + tileSize - 1) / tileSize;
+    size_t total = columns * rows;
+
+    // every worker gets continuous run of tiles to keep neighbours in one cache
+    for (size_t w = 0, i = 0; w < count; ++w) {
+        std::deque<Tile>& tiles = queues[w].tiles;
+        tiles.clear();
+
+        for (size_t to = total * (w + 1) / count; i < to; ++i) {
+            size_t x = (i % columns) * tileSize;
+            size_t y = (i / columns) * tileSize;
+            tiles.push_back({x, y, std::min(x + tileSize, width), std::min(y + tileSize, height)});
+        }
+    }
+}
+
+bool TileScheduler::next(size_t worker, Tile& tile) {
+    {
+        Queue& own = queues[worker];
+        std::lock_guard<std::mutex> lock(own.mutex);
+
+        if (!own.tiles.empty()) {
+            tile = own.tiles.front();
+            own.tiles.pop_front();
+            ++workers[worker].tiles;
+            return true;
+        }
+    }
+
+    // tiles are never added after reset, so the empty deques stay empty
+    for (size_t i = 1; i < workersCount; ++i) {
+        Queue& victim = queues[(worker + i) % workersCount];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+
+        if (!victim.tiles.empty()) {
+            tile = victim.tiles.back();
+            victim.tiles.pop_back();
+            ++workers[worker].tiles;
+            ++workers[worker].stolen;
+            return true;
+        }
+    }
+    return false;
+}
+
+WorkerStats& TileScheduler::workerStats(size_t worker) {
+    return workers[worker];
+}
+
+LoadBalanceStats TileScheduler::stats() const {
+    LoadBalanceStats res;
+
+    for (auto const& w : workers) {
+        res.tiles += w.tiles;
+        res.stolen += w.stolen;
+        res.meanBusyMs += w.busyMs;
+        res.maxBusyMs = std::max(res.maxBusyMs, w.busyMs);
+        res.maxColoringMs = std::max(res.maxColoringMs, w.coloringMs);
+        res.maxHistogramMs = std::max(res.maxHistogramMs, w.histogramMs);
+    }
+
+    if (!workers.empty()) {
+        res.meanBusyMs /= workers.size();
+    }
+    return res;
+}
+
+}
@@ -0,0 +1,155 @@
+#include "trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace mandelbrot::trace {
+
+std::atomic_bool enabled = false;
+
+namespace {
+
+const uint64_t RING_SIZE = 1 << 16;
+// the slots which spans finished after the stop may still be written to, they are not read
+const uint64_t RING_MARGIN = 64;
+
+struct Event {
+    char const* name;
+    size_t frameSeqId;
+    int64_t begin;
+    int64_t end;
+    size_t tid;
+};
+
+// written by its thread only, without locks. the owner publishes the count of the written events
+struct Ring {
+    std::unique_ptr<Event[]> events = std::make_unique<Event[]>(RING_SIZE);
+    std::atomic<uint64_t> written = 0;
+    uint64_t started = 0; // written at the start, guarded by the mutex
+};
+
+// the rings of the finished threads go to the next ones, the events keep their threads,
+// so there are as many rings as the threads traced at once (the pool is resized, the exports come and go)
+std::mutex mutex;
+std::vector<std::unique_ptr<Ring>> rings;
+std::vector<Ring*> freeRings; // guarded by the mutex
+std::vector<std::string> threadNames; // of all the traced threads by tid - 1, guarded by the mutex
+int64_t startTime = 0; // guarded by the mutex
+
+struct ThreadRing {
+    Ring* ring = nullptr;
+    size_t tid = 0;
+
+    ~ThreadRing() {
+        if (ring != nullptr) {
+            std::lock_guard<std::mutex> lock(mutex);
+            freeRings.push_back(ring);
+        }
+    }
+};
+
+thread_local ThreadRing threadRing;
+thread_local std::string threadName;
+
+ThreadRing& ring() {
+    if (threadRing.ring == nullptr) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (freeRings.empty()) {
+            rings.push_back(std::make_unique<Ring>());
+            threadRing.ring = rings.back().get();
+        } else {
+            threadRing.ring = freeRings.back();
+            freeRings.pop_back();
+        }
+        threadNames.push_back(threadName);
+        threadRing.tid = threadNames.size();
+    }
+    return threadRing;
+}
+
+// JSON strings of the thread names, the span names are literals without quotes
+std::string escaped(std::string const& text) {
+    std::string res;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            res += '\\';
+        }
+        res += static_cast<unsigned char>(c) < 0x20 ? ' ' : c;
+    }
+    return res;
+}
+
+}
+
+int64_t now() {
+    auto time = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time).count();
+}
+
+void record(char const* name, size_t frameSeqId, int64_t begin, int64_t end) {
+    ThreadRing& owner = ring();
+    Ring& r = *owner.ring;
+    uint64_t index = r.written.load(std::memory_order_relaxed);
+    r.events[index % RING_SIZE] = {name, frameSeqId, begin, end, owner.tid};
+    r.written.store(index + 1, std::memory_order_release);
+}
+
+void setThreadName(std::string const& name) {
+    threadName = name;
+    if (threadRing.ring != nullptr) {
+        std::lock_guard<std::mutex> lock(mutex);
+        threadNames[threadRing.tid - 1] = name;
+    }
+}
+
+void start() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto const& r : rings) {
+        r->started = r->written.load(std::memory_order_acquire);
+    }
+    startTime = now();
+    enabled.store(true, std::memory_order_release);
+}
+
+bool stop(std::string const& fileName) {
+    enabled.store(false, std::memory_order_release);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::FILE* file = std::fopen(fileName.c_str(), "w");
+    if (file == nullptr) {
+        return false;
+    }
+
+    // complete events in microseconds, every thread is named by a metadata event
+    std::fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+    const char* separator = "\n";
+    std::vector<bool> traced(threadNames.size());
+    for (auto const& r : rings) {
+        const uint64_t written = r->written.load(std::memory_order_acquire);
+        const uint64_t first = written > RING_SIZE - RING_MARGIN ? std::max(r->started, written - RING_SIZE + RING_MARGIN)
+                                                                 : r->started;
+        for (uint64_t i = first; i < written; ++i) {
+            Event const& event = r->events[i % RING_SIZE];
+            std::fprintf(file, "%s{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %zu, \"ts\": %.3f, \"dur\": %.3f, "
+                               "\"args\": {\"frame\": %zu}}",
+                         separator, event.name, event.tid, (event.begin - startTime) / 1e3,
+                         (event.end - event.begin) / 1e3, event.frameSeqId);
+            separator = ",\n";
+            traced[event.tid - 1] = true;
+        }
+    }
+    for (size_t tid = 1; tid <= traced.size(); ++tid) {
+        if (traced[tid - 1]) {
+            std::string const& name = threadNames[tid - 1];
+            std::fprintf(file, ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %zu, \"args\": {\"name\": \"%s\"}}",
+                         tid, escaped(name.empty() ? "thread " + std::to_string(tid) : name).c_str());
+        }
+    }
+    std::fprintf(file, "\n]}\n");
+    return std::fclose(file) == 0;
+}
+
+}
@@ -1,27 +1,48 @@
 #include "statusbar.h"
 #include <QString>
-#include <QTimer>
-#include <QLocale>
+#include <QStringList>
 
-StatusBar::StatusBar(QWidget *parent)
-    : QWidget(parent), prevRendererState(mandelbrot::RendererState::INITIAL_RENDERING)
-{
-    qtimer = new QTimer(this);
-    connect(qtimer, SIGNAL(timeout()), this, SLOT(updateTimer()));
+namespace {
+
+// 12.3 M, the counters of the large frames are hard to read otherwise
+QString count(uint64_t value) {
+    if (value >= 10'000'000) {
+        return QString("%1 M").arg(QString::number(value / 1e6, 'f', 1));
+    }
+    if (value >= 10'000) {
+        return QString("%1 k").arg(QString::number(value / 1e3, 'f', 1));
+    }
+    return QString::number(value);
 }
 
-void StatusBar::updateInfo(mandelbrot::ViewportInfo info) {
-    using namespace mandelbrot;
+QString milliseconds(double ms) {
+    return QString("%1 ms").arg(QString::number(ms, 'f', 1));
+}
+
+}
 
-    // unfortunately, QWidget constructor knows nothing about children
-    // that's why we try to find them here
+StatusBar::StatusBar(QWidget *parent)
+    : QWidget(parent)
+{
+}
 
+// unfortunately, QWidget constructor knows nothing about children
+// that's why we try to find them here
+void StatusBar::findLabels() {
     if (status == nullptr) {
         status = findChild<QLabel*>("status");
         coords = findChild<QLabel*>("coords");
         scale = findChild<QLabel*>("scale");
         timer = findChild<QLabel*>("timer");
+        // the stats are drawn over the viewport, so they aren't among the children
+        stats = window()->findChild<QLabel*>("stats");
     }
+}
+
+void StatusBar::updateInfo(mandelbrot::ViewportInfo info) {
+    using namespace mandelbrot;
+
+    findLabels();
 
     const QString x = QString::number(info.offset.x, 'f', 10);
     const QString y = QString::number(info.offset.y, 'f', 10);
@@ -37,71 +58,60 @@ void StatusBar::updateInfo(mandelbrot::ViewportInfo info) {
         scale->setStyleSheet("color: white");
     }
 
-    // DFA analysis. no more comments
-
+    // the time is measured by the renderer and comes with the stats of every stage
     switch (info.state) {
     case RendererState::READY:
         status->setText("Ready");
-        if (prevRendererState == RendererState::RENDERING) {
-            qtimer->stop();
-            updateTimer();
-        }
-        if (time > 0) {
-            time -= 0.01;
-            updateTimer();
-        }
         break;
 
     case RendererState::INITIAL_RENDERING:
-        time = 0;
-        qtimer->stop();
         coords->setText("");
         scale->setText("");
         status->setText("");
         timer->setText("");
+        stats->setText("");
         break;
 
     case RendererState::RENDERING:
         status->setText("Rendering...");
-        if (prevFrameSeqId != info.frameSeqId) {
-            qtimer->stop();
-            time = 0;
-            qtimer->start(10); // 10ms
-        }
         break;
 
     case RendererState::OFFLINE:
         status->setText("Offline");
-        qtimer->stop();
         timer->setText("");
-
-        switch (prevRendererState) {
-        case RendererState::RENDERING:
-        case RendererState::INITIAL_RENDERING:
-            time = 0;
-        default:
-            break;
-        }
+        break;
     }
-
-    prevFrameSeqId = info.frameSeqId;
-    prevRendererState = info.state;
 }
 
-void StatusBar::updateTimer() {
+void StatusBar::updateStats(mandelbrot::FrameStats frame) {
     using namespace mandelbrot;
 
-    time += 0.01;
-    timer->setText(QString("%1 sec ").arg(QString::number(time, 'f', 2)));
+    findLabels();
 
-    if (time >= WARN_RENDER_LATENCY) {
+    const double seconds = frame.elapsedMs / 1000;
+    timer->setText(QString("%1 sec ").arg(QString::number(seconds, 'f', 2)));
+    if (seconds >= WARN_RENDER_LATENCY) {
         timer->setStyleSheet("color: yellow");
     } else {
         timer->setStyleSheet("color: white");
     }
-}
 
-StatusBar::~StatusBar() {
-    qtimer->stop();
-    delete qtimer;
+    const uint64_t samples = frame.escaped + frame.converged + frame.capped;
+    QStringList passes;
+    for (size_t i = 0; i < frame.passesCount; ++i) {
+        passes << QString("%1 %2").arg(QString(frame.passes[i].name), milliseconds(frame.passes[i].ms));
+    }
+    QStringList workers;
+    for (size_t i = 0; i < frame.workersCount; ++i) {
+        workers << milliseconds(frame.busyMs[i]);
+    }
+
+    stats->setText(
+        QString("iterations %1, %2 per sample\n").arg(count(frame.iterations),
+                                                       QString::number(samples ? double(frame.iterations) / samples : 0, 'f', 1))
+        + QString("samples %1: %2 escaped, %3 converged, %4 at the limit, %5 pixels reused, %6 skipped\n")
+                .arg(count(samples), count(frame.escaped), count(frame.converged),
+                     count(frame.capped), count(frame.reused), count(frame.skipped))
+        + QString("passes: %1\n").arg(passes.join(", "))
+        + QString("workers busy: %1").arg(workers.join(", ")));
 }
@@ -1,18 +1,32 @@
 #include "viewport.h"
+#include "trace.h"
 #include <QDebug>
 #include <QLabel>
 #include <QMouseEvent>
 #include <cmath>
+#include <QFile>
 #include <QFileDialog>
+#include <QInputDialog>
 #include <QMessageBox>
+#include <QImage>
 
 Viewport::Viewport(QWidget* parent)
     : QWidget(parent) {
+    downscaledFrame.pixelSize = mandelbrot::DOWNSCALE_LEVEL;
+
+    // renderer doesn't wait for the viewport, it only lets it know there is something to take
     connect(&renderer,
-            SIGNAL(frameDelivery(QImage,bool,size_t)),
+            SIGNAL(frameReady()),
             this,
-            SLOT(updateFrame(QImage,bool,size_t)),
-            Qt::BlockingQueuedConnection);
+            SLOT(updateFrames()),
+            Qt::QueuedConnection);
+
+    exporter.setProgressCallback([this](size_t rows, size_t height) {
+        emit exportProgress(static_cast<int>(100 * rows / height));
+    });
+    exporter.setFinishedCallback([this](std::string const& error) {
+        emit exportFinished(QString::fromStdString(error));
+    });
 }
 
 bool Viewport::ready() const {
@@ -21,6 +35,7 @@ bool Viewport::ready() const {
 }
 
 void Viewport::paintEvent(QPaintEvent*) {
+    mandelbrot::trace::Span span("paintEvent", frameSeqId);
     QPainter p(this);
     p.fillRect(0, 0, width(), height(), Qt::black);
 
@@ -110,6 +125,9 @@ mandelbrot::RendererSettings Viewport::getRendererSettings() const {
 
 void Viewport::setOffline(bool offline) {
     if (offline) {
+        // the frames are taken and dropped from now on, the shown ones stay
+        downscaledFrame.detach();
+        detailedFrame.detach();
         rendererState = mandelbrot::RendererState::OFFLINE;
     } else {
         rendererState = mandelbrot::RendererState::READY;
@@ -130,7 +148,13 @@ void Viewport::setLowResolution(bool val) {
 }
 
 void Viewport::setRendererSettings(mandelbrot::RendererSettings settings) {
+    bool recolor = settings.coloring != renderer.getSettings().coloring;
     renderer.setSettings(settings);
+
+    // pixels are known to the renderer, so it is only a coloring pass
+    if (recolor) {
+        requestFrame(true);
+    }
 }
 
 void Viewport::move(QPointF pixels, bool update, bool requestFrame) {
@@ -139,12 +163,14 @@ void Viewport::move(QPointF pixels, bool update, bool requestFrame) {
     }
 
     using namespace mandelbrot;
-    Pos diff = pixels * scale;
-    Pos allowed = (centerOffset - diff).fit(ALLOWED_COORDS_RECT) - centerOffset;
+    size_t precision = centerOffset.precision();
+    BigPos diff(BigFixed(scale * pixels.x(), precision), BigFixed(scale * pixels.y(), precision));
+    BigPos allowed = (centerOffset - diff).fit(ALLOWED_COORDS_MIN, ALLOWED_COORDS_MAX) - centerOffset;
+    QPointF allowedPixels((allowed.x.toFloatExp() / scale).toDouble(), (allowed.y.toFloatExp() / scale).toDouble());
 
     // offline
-    downscaledFrame.drag(-QPointF(allowed.x, allowed.y) / scale);
-    detailedFrame.drag(-QPointF(allowed.x, allowed.y) / scale);
+    downscaledFrame.drag(-allowedPixels);
+    detailedFrame.drag(-allowedPixels);
 
     // online
     centerOffset += allowed;
@@ -174,6 +200,12 @@ void Viewport::zoom(QPointF mousePos, double steps) {
     if (dy != 0) {
         double factor = std::pow(SCALE_STEP, dy);
 
+        // the center has to address pixels of the new scale, even under the cursor
+        size_t precision = BigFixed::limbsFor(scale * factor);
+        if (precision > centerOffset.precision()) {
+            centerOffset.setPrecision(precision);
+        }
+
         QPointF viewportCenter = QPointF(width(), height()) / 2.0;
         QPointF newCenterOffset = viewportCenter * factor;
         QPointF oldCenterOffset = viewportCenter;
@@ -207,27 +239,46 @@ void Viewport::zoom(QPointF mousePos, double steps) {
 }
 
 bool Viewport::screenshot() {
+    using namespace mandelbrot;
+
     if (!ready()) {
         return false;
     }
 
-    const static QString caption = "Export screenshot";
-    const static QString filter = "Images (*.png)";
-
-    bool prev = getOffline();
-    setOffline(true);
+    const static QString caption = "Export image";
+    const static QString filter = "PNG (*.png);;TIFF (*.tif *.tiff)";
 
-    // nobody can repaint the widget now, so we render it safely.
+    // the export goes on in background, so another one can only replace it
+    if (exporter.busy()) {
+        auto answer = QMessageBox::question(this, caption, "Cancel the export in progress?");
+        if (answer == QMessageBox::Yes) {
+            exporter.cancel();
+        }
+        return true;
+    }
 
     QString fileName = QFileDialog::getSaveFileName(this, caption, QString(), filter);
-
-    if (!fileName.isEmpty()) {
-        QPixmap screenshot(size());
-        render(&screenshot, QPoint(), QRegion(), RenderFlags());
-        screenshot.save(fileName, "PNG");
+    if (fileName.isEmpty()) {
+        return true;
     }
 
-    setOffline(prev);
+    // the same part of the plane as the widget shows, with as many pixels as asked
+    bool ok;
+    int exportWidth = QInputDialog::getInt(this, caption, "Width in pixels, the height keeps the proportions",
+                                           width(), 1, Exporter::MAX_SIZE, 1, &ok);
+    if (!ok) {
+        return true;
+    }
+    double factor = exportWidth / (double) width();
+    Size exportSize(exportWidth, qBound(1, (int) std::lround(height() * factor), Exporter::MAX_SIZE));
+
+    // the iterations count of the shown frame, the automatic one is adapted by the frames and the bands can't be
+    mandelbrot::RendererSettings settings = renderer.getSettings();
+    settings.iterationsCountAuto = false;
+    if (!exporter.start(QFile::encodeName(fileName).toStdString(), centerOffset, exportSize,
+                        scale / FloatExp(factor), scaleLog + std::log2(factor), settings)) {
+        QMessageBox::warning(this, caption, "Only PNG and TIFF images can be exported");
+    }
     return true;
 }
 
@@ -235,7 +286,7 @@ void Viewport::reset() {
     using namespace mandelbrot;
 
     // make sure reset is not useless
-    bool check = (scale != INITIAL_SCALE) || (centerOffset != INTIAL_CENTER_OFFSET);
+    bool check = (scale != INITIAL_SCALE) || (centerOffset != BigPos(INTIAL_CENTER_OFFSET));
     check |= downscaledFrame.changed();
 
     if (check) {
@@ -252,42 +303,49 @@ void Viewport::reset() {
     }
 }
 
-void Viewport::updateFrame(QImage frame, bool downscaled, size_t frameSeqId) {
-    // discard previous frames. yes, it can happen.
-    if (frameSeqId != this->frameSeqId) {
+void Viewport::updateFrames() {
+    mandelbrot::trace::Span span("frameDelivery", frameSeqId);
+    // the overview goes first, as the renderer publishes it before the precise stages
+    updateFrame(true);
+    updateFrame(false);
+    broadcastWidgetInfo();
+}
+
+void Viewport::updateFrame(bool downscaled) {
+    mandelbrot::FrameExchange& exchange = renderer.frames(downscaled);
+    if (!exchange.take()) {
         return;
     }
 
-    if (!getOffline()) {
-        if (downscaled) {
-            if (!lowResolution) {
-                delayedFrame = QPixmap::fromImage(frame);
-            } else {
-                downscaledFrame.setPixmap(QPixmap::fromImage(frame));
-                downscaledFrame.restore();
-            }
-
-        } else {
-            detailedFrame.setPixmap(QPixmap::fromImage(frame));
-            detailedFrame.restore();
-
-            if (!delayedFrame.isNull()) {
-                downscaledFrame.setPixmap(delayedFrame);
-                downscaledFrame.restore();
-                delayedFrame = QPixmap();
-            }
-        }
+    // discard previous frames. yes, it can happen.
+    // the shown pixmaps are detached by the request and by going offline, as the take gives their pixels back
+    mandelbrot::FrameInfo const& info = exchange.info();
+    if (info.frameSeqId != frameSeqId || getOffline()) {
+        return;
+    }
 
-        if (lowResolution || !downscaled) {
-            rendererState = mandelbrot::RendererState::READY;
-        }
-        update();
+    // every stage of the frame is shown as soon as it is ready, restoring twice is harmless.
+    // the pixmap may share the pixels of the wrapping image, they stay until the next take
+    mandelbrot::Frame& target = downscaled ? downscaledFrame : detailedFrame;
+    mandelbrot::Image const& image = exchange.image();
+    QImage wrapped(reinterpret_cast<uchar const*>(image.bits()), image.width(), image.height(),
+                   image.width() * sizeof(mandelbrot::Rgb), QImage::Format_RGB32);
+    {
+        mandelbrot::trace::Span span("QPixmap::fromImage", info.frameSeqId);
+        target.setPixmap(QPixmap::fromImage(wrapped), true);
     }
+    target.restore(QPointF(info.offset.x, info.offset.y));
+    emit frameStatsDelivery(info.stats);
 
-    broadcastWidgetInfo();
+    if (info.complete) {
+        rendererState = mandelbrot::RendererState::READY;
+    } else if (rendererState == mandelbrot::RendererState::INITIAL_RENDERING) {
+        rendererState = mandelbrot::RendererState::RENDERING;
+    }
+    update();
 }
 
-void Viewport::requestFrame() {
+void Viewport::requestFrame(bool force) {
     if (getOffline()) {
         broadcastWidgetInfo();
         return;
@@ -295,7 +353,7 @@ void Viewport::requestFrame() {
 
     if (downscaledFrame.isNull() && detailedFrame.isNull()) {
         rendererState = mandelbrot::RendererState::INITIAL_RENDERING;
-    } else if (downscaledFrame.changed() || (detailedFrame.changed() && !lowResolution)) {
+    } else if (force || downscaledFrame.changed() || (detailedFrame.changed() && !lowResolution)) {
         rendererState = mandelbrot::RendererState::RENDERING;
     } else {
         rendererState = mandelbrot::RendererState::READY;
@@ -303,7 +361,12 @@ void Viewport::requestFrame() {
         return;
     }
 
+    // the frames of the previous request are dropped from now on, the shown ones stay
+    downscaledFrame.detach();
+    detailedFrame.detach();
+
     ++frameSeqId;
+    mandelbrot::trace::Span span("Viewport::requestFrame", frameSeqId);
     broadcastWidgetInfo();
 
     downscaledFrame.save();
@@ -313,5 +376,5 @@ void Viewport::requestFrame() {
 }
 
 void Viewport::broadcastWidgetInfo() {
-    emit widgetInfoDelivery({centerOffset, scaleLog, rendererState, frameSeqId});
+    emit widgetInfoDelivery({centerOffset.toPos(), scaleLog, rendererState, frameSeqId});
 }
@@ -1,5 +1,6 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
+#include "kernels.h"
 #include <QKeyEvent>
 #include <QMessageBox>
 
@@ -15,6 +16,18 @@ MainWindow::MainWindow(QWidget *parent)
         viewport, SIGNAL(widgetInfoDelivery(mandelbrot::ViewportInfo)),
         statusbar, SLOT(updateInfo(mandelbrot::ViewportInfo))
     );
+    connect(
+        viewport, SIGNAL(frameStatsDelivery(mandelbrot::FrameStats)),
+        statusbar, SLOT(updateStats(mandelbrot::FrameStats))
+    );
+    connect(viewport, SIGNAL(exportProgress(int)), this, SLOT(export_progress(int)));
+
+    // the stats panel is folded until it is asked for. it is drawn over the viewport,
+    // so its text never resizes the frame, and the viewport is dragged through it
+    ui->stats->hide();
+    ui->stats->setAttribute(Qt::WA_TransparentForMouseEvents);
+    connect(ui->statsToggle, SIGNAL(toggled(bool)), ui->stats, SLOT(setVisible(bool)));
+    connect(viewport, SIGNAL(exportFinished(QString)), this, SLOT(export_finished(QString)));
     setFocus();
 }
 
@@ -86,11 +99,24 @@ void MainWindow::on_screenshot_clicked() {
         QMessageBox::information(
                     this,
                     "Invalid action",
-                    "Screenshot capture is impossible during initial rendering"
+                    "Export is impossible during initial rendering"
                     );
     }
 }
 
+void MainWindow::export_progress(int percent) {
+    ui->screenshot->setText(QString("(S) Export %1%").arg(percent));
+}
+
+void MainWindow::export_finished(QString error) {
+    const static QString idle = "(S) Export";
+    ui->screenshot->setText(idle);
+
+    if (!error.isEmpty()) {
+        QMessageBox::warning(this, "Export failed", error);
+    }
+}
+
 void MainWindow::on_parameters_clicked() {
     dialog = new ParametersDialog(this, viewport);
     dialog->show();
@@ -108,15 +134,11 @@ void MainWindow::parameters_closed(int saved) {
 }
 
 void MainWindow::on_about_clicked() {
-    QString info = "Interactive visualizer of the Mandelbrot set\nPerformed by letstatt\n\nAVX2: %1";
+    QString info = "Interactive visualizer of the Mandelbrot set\nPerformed by letstatt\n\nKernel: %1";
     QMessageBox::about(
                 this,
                 "About",
-#ifdef AVX
-                info.arg("on")
-#else
-                info.arg("off")
-#endif
+                info.arg(mandelbrot::kernels::active().name)
                 );
 }
 
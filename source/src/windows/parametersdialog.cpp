@@ -1,5 +1,24 @@
 #include "parametersdialog.h"
 #include "ui_parametersdialog.h"
+#include <cmath>
+
+namespace {
+
+// the iterations slider goes in octaves, the counts are from 64 to a million
+const int ITERATIONS_SLIDER_STEPS_PER_OCTAVE = 8;
+
+int iterationsSliderPosition(size_t iterationsCount) {
+    using namespace mandelbrot;
+    return static_cast<int>(std::lround(ITERATIONS_SLIDER_STEPS_PER_OCTAVE
+                                        * std::log2(static_cast<double>(iterationsCount) / MIN_ITERATIONS_BY_PIXEL)));
+}
+
+size_t iterationsAt(int position) {
+    using namespace mandelbrot;
+    return std::llround(MIN_ITERATIONS_BY_PIXEL * std::exp2(static_cast<double>(position) / ITERATIONS_SLIDER_STEPS_PER_OCTAVE));
+}
+
+}
 
 ParametersDialog::ParametersDialog(QWidget *parent, Viewport const* viewport) :
     QDialog(parent),
@@ -28,22 +47,39 @@ ParametersDialog::ParametersDialog(QWidget *parent, Viewport const* viewport) :
     ui->iterations_auto->setChecked(settings.iterationsCountAuto);
     connect(ui->iterations_auto, SIGNAL(stateChanged(int)), this, SLOT(iterations_auto_toggled(int)));
 
+    // subdivision checkbox
+    ui->subdivision->setChecked(settings.subdivision);
+    connect(ui->subdivision, SIGNAL(stateChanged(int)), this, SLOT(subdivision_toggled(int)));
+
+    // coloring combobox, items go in the order of mandelbrot::Coloring
+    ui->coloring->setCurrentIndex(settings.coloring);
+    connect(ui->coloring, SIGNAL(currentIndexChanged(int)), this, SLOT(coloring_changed(int)));
+
     // threads count slider
     ui->threads_slider->setRange(1, MAX_THREADS_COUNT);
     ui->threads_slider->setValue(settings.threadsCount);
     threads_slider_update(settings.threadsCount);
     connect(ui->threads_slider, SIGNAL(valueChanged(int)), this, SLOT(threads_slider_update(int)));
 
-    // iterations count slider
-    ui->iterations_slider->setRange(MIN_ITERATIONS_BY_PIXEL, MAX_ITERATIONS_BY_PIXEL);
-    ui->iterations_slider->setValue(settings.iterationsCount);
-    iterations_slider_update(settings.iterationsCount);
+    // iterations count slider, the count is kept as it is until the slider is moved
+    ui->iterations_slider->setRange(0, iterationsSliderPosition(MAX_ITERATIONS_BY_PIXEL));
+    ui->iterations_slider->setPageStep(ITERATIONS_SLIDER_STEPS_PER_OCTAVE);
+    ui->iterations_slider->setValue(iterationsSliderPosition(settings.iterationsCount));
+    ui->iterations_counter->setText(QString("Iterations per pixel: %1").arg(settings.iterationsCount));
     connect(ui->iterations_slider, SIGNAL(valueChanged(int)), this, SLOT(iterations_slider_update(int)));
+
+    // tile cache budget slider
+    ui->cache_slider->setRange(0, MAX_TILE_CACHE_MEGABYTES);
+    ui->cache_slider->setSingleStep(16);
+    ui->cache_slider->setPageStep(128);
+    ui->cache_slider->setValue(settings.tileCacheMegabytes);
+    cache_slider_update(settings.tileCacheMegabytes);
+    connect(ui->cache_slider, SIGNAL(valueChanged(int)), this, SLOT(cache_slider_update(int)));
 }
 
-void ParametersDialog::iterations_slider_update(int val) {
-    ui->iterations_counter->setText(QString("Iterations per pixel: %1").arg(val));
-    settings.iterationsCount = val;
+void ParametersDialog::iterations_slider_update(int position) {
+    settings.iterationsCount = iterationsAt(position);
+    ui->iterations_counter->setText(QString("Iterations per pixel: %1").arg(settings.iterationsCount));
 }
 
 void ParametersDialog::threads_slider_update(int val) {
@@ -51,6 +87,11 @@ void ParametersDialog::threads_slider_update(int val) {
     settings.threadsCount = val;
 }
 
+void ParametersDialog::cache_slider_update(int val) {
+    ui->cache_counter->setText(val > 0 ? QString("Tile cache: %1 MB").arg(val) : QString("Tile cache: off"));
+    settings.tileCacheMegabytes = val;
+}
+
 void ParametersDialog::zoom_toggled(int state) {
     cursorDependentZoom = (state > 0);
 }
@@ -67,6 +108,14 @@ void ParametersDialog::iterations_auto_toggled(int state) {
     settings.iterationsCountAuto = (state > 0);
 }
 
+void ParametersDialog::subdivision_toggled(int state) {
+    settings.subdivision = (state > 0);
+}
+
+void ParametersDialog::coloring_changed(int index) {
+    settings.coloring = static_cast<mandelbrot::Coloring>(index);
+}
+
 ParametersDialog::~ParametersDialog() {
     delete ui;
 }
@@ -0,0 +1,128 @@
+#include "workerpool.h"
+#include "trace.h"
+#include <string>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#elif defined(__APPLE__)
+#include <pthread.h>
+#endif
+
+namespace mandelbrot {
+
+WorkerPool::WorkerPool(size_t count) {
+    resize(count);
+}
+
+void WorkerPool::resize(size_t count) {
+    size_t prev = workers.size();
+    if (count == prev) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        target = count;
+    }
+
+    if (count < prev) {
+        // extra workers finish their current jobs and leave
+        jobsCv.notify_all();
+        for (size_t i = count; i < prev; ++i) {
+            workers[i].join();
+        }
+        workers.resize(count);
+    } else {
+        for (size_t i = prev; i < count; ++i) {
+            workers.emplace_back(&WorkerPool::loop, this, i);
+        }
+    }
+}
+
+void WorkerPool::setPriority(ThreadPriority value) {
+    std::lock_guard<std::mutex> lock(mutex);
+    priority = value;
+}
+
+size_t WorkerPool::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return target;
+}
+
+void WorkerPool::submit(Job job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(std::move(job));
+    }
+    jobsCv.notify_one();
+}
+
+void WorkerPool::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    doneCv.wait(lock, [this] {
+        return (jobs.empty() || target == 0) && running == 0;
+    });
+}
+
+void WorkerPool::loop(size_t index) {
+    trace::setThreadName("worker " + std::to_string(index));
+
+    std::unique_lock<std::mutex> lock(mutex);
+    setThreadPriority(priority);
+
+    while (true) {
+        jobsCv.wait(lock, [this, index] {
+            return shutdown || index >= target || !jobs.empty();
+        });
+
+        if (shutdown || index >= target) {
+            return;
+        }
+
+        Job job = std::move(jobs.front());
+        jobs.pop_front();
+        ++running;
+
+        lock.unlock();
+        job(index);
+        lock.lock();
+
+        --running;
+        if (jobs.empty() && running == 0) {
+            doneCv.notify_all();
+        }
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        shutdown = true;
+    }
+    jobsCv.notify_all();
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void setThreadPriority(ThreadPriority priority) {
+    if (priority == ThreadPriority::NORMAL) {
+        return;
+    }
+    const bool background = priority == ThreadPriority::BACKGROUND;
+#if defined(_WIN32)
+    SetThreadPriority(GetCurrentThread(), background ? THREAD_PRIORITY_LOWEST : THREAD_PRIORITY_BELOW_NORMAL);
+#elif defined(__linux__)
+    // linux threads have their own nice values
+    setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), background ? 19 : 5);
+#elif defined(__APPLE__)
+    pthread_set_qos_class_self_np(background ? QOS_CLASS_BACKGROUND : QOS_CLASS_UTILITY, 0);
+#endif
+}
+
+}
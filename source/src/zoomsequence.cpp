@@ -0,0 +1,298 @@
+#include "zoomsequence.h"
+#include "exporter.h"
+#include "imagewriter.h"
+#include "log.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <vector>
+
+namespace mandelbrot {
+
+namespace {
+
+// the one %d of the pattern, zero padded to the width if it has one, like %05d
+bool frameName(std::string const& pattern, size_t index, std::string& name) {
+    size_t percent = pattern.find('%');
+    if (percent == std::string::npos || pattern.find('%', percent + 1) != std::string::npos) {
+        return false;
+    }
+
+    size_t end = percent + 1;
+    while (end < pattern.size() && std::isdigit(static_cast<unsigned char>(pattern[end]))) {
+        ++end;
+    }
+    if (end == pattern.size() || pattern[end] != 'd') {
+        return false;
+    }
+
+    size_t width = end > percent + 1 ? std::stoul(pattern.substr(percent + 1, end - percent - 1)) : 0;
+    std::string number = std::to_string(index);
+    if (number.size() < width) {
+        number.insert(0, width - number.size(), '0');
+    }
+    name = pattern.substr(0, percent) + number + pattern.substr(end + 1);
+    return true;
+}
+
+bool isRawVideo(std::string const& fileName) {
+    size_t dot = fileName.find_last_of("./\\");
+    std::string extension = dot != std::string::npos && fileName[dot] == '.' ? fileName.substr(dot + 1) : "";
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) {
+        return std::tolower(c);
+    });
+    return extension == "rgb" || extension == "raw";
+}
+
+// octaves are powers of two exactly, so the key frames are compatible with each other
+FloatExp deeper(FloatExp scale, double octaves) {
+    double whole = std::floor(octaves);
+    return FloatExp(scale.mantissa * std::exp2(whole - octaves), scale.exponent - static_cast<int64_t>(whole));
+}
+
+// the same scale log as the viewport has, for the automatic iterations count
+double scaleLogOf(FloatExp scale) {
+    return 1 + std::log2(INITIAL_SCALE) - scale.log2();
+}
+
+/*
+ * Bilinear samples of the key frame, which pixels are ratio times smaller.
+ * Key frame center is offset pixels away from the frame one.
+ */
+void resample(Image const& key, Pos offset, double ratio, Image& frame, WorkerPool& pool) {
+    const int width = frame.width();
+    const int height = frame.height();
+
+    auto positions = [ratio](int size, int keySize, double shift, std::vector<int>& from, std::vector<float>& weight) {
+        from.resize(size);
+        weight.resize(size);
+        for (int i = 0; i < size; ++i) {
+            double at = (i + 0.5 - size / 2.) * ratio + keySize / 2. - 0.5 - shift;
+            at = std::clamp(at, 0., keySize - 1.);
+            from[i] = std::min(static_cast<int>(at), keySize - 2);
+            weight[i] = static_cast<float>(at - from[i]);
+        }
+    };
+    std::vector<int> columns, rows;
+    std::vector<float> columnWeights, rowWeights;
+    positions(width, key.width(), offset.x, columns, columnWeights);
+    positions(height, key.height(), offset.y, rows, rowWeights);
+
+    auto mix = [](Rgb a, Rgb b, float t) {
+        auto channel = [t](uint32_t u, uint32_t v) {
+            return static_cast<uint32_t>(u + (static_cast<float>(v) - u) * t + 0.5f);
+        };
+        return rgb(channel(red(a), red(b)), channel(green(a), green(b)), channel(blue(a), blue(b)));
+    };
+
+    const int strip = ImageWriter::STRIP_HEIGHT;
+    for (int y0 = 0; y0 < height; y0 += strip) {
+        pool.submit([&, y0](size_t) {
+            for (int y = y0; y < std::min(y0 + strip, height); ++y) {
+                Rgb const* top = key.scanLine(rows[y]);
+                Rgb const* bottom = key.scanLine(rows[y] + 1);
+                Rgb* out = frame.bits() + static_cast<size_t>(y) * width;
+
+                for (int x = 0; x < width; ++x) {
+                    const int i = columns[x];
+                    const float t = columnWeights[x];
+                    out[x] = mix(mix(top[i], top[i + 1], t), mix(bottom[i], bottom[i + 1], t), rowWeights[y]);
+                }
+            }
+        });
+    }
+    pool.wait();
+}
+
+}
+
+void ZoomSequence::setProgressCallback(Progress callback) {
+    progressCallback = std::move(callback);
+}
+
+std::string ZoomSequence::render(std::string const& output, BigPos const& center, Size size,
+                                 FloatExp from, FloatExp to, size_t count, RendererSettings settings) {
+    const bool raw = isRawVideo(output);
+    std::string name;
+    if (!raw && (!frameName(output, 0, name) || !ImageWriter::create(name))) {
+        return "the output is neither a .rgb file nor a pattern of png, tif or ppm files like zoom_%05d.png";
+    }
+    if (count == 0 || size.isEmpty() || size.width() > Exporter::MAX_SIZE / 2 || size.height() > Exporter::MAX_SIZE / 2) {
+        return "no frames of this size can be rendered";
+    }
+    auto start = std::chrono::steady_clock::now();
+
+    // frame depths are spread evenly in octaves, negative ones zoom out
+    const double depth = from.log2() - to.log2();
+    auto frameDepth = [&](size_t frame) {
+        return count > 1 ? depth * frame / (count - 1) : 0.;
+    };
+    auto keyOf = [&](size_t frame) {
+        return static_cast<int64_t>(std::floor(frameDepth(frame)));
+    };
+
+    // the samples carried over to a higher iterations count are iterated again when they were at the limit,
+    // so all the key frames get the one of the deepest
+    Engine engine;
+    if (settings.iterationsCountAuto) {
+        const int64_t deepest = std::max(keyOf(0), keyOf(count - 1));
+        settings.iterationsCount = engine.iterationsCountAuto(scaleLogOf(deeper(from, deepest + 1)));
+        settings.iterationsCountAuto = false;
+    }
+    settings.progressive = false;
+    settings.tileCacheMegabytes = 0;
+    engine.setSettings(settings);
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool published = false;
+    engine.setFrameCallback([&] {
+        std::lock_guard<std::mutex> lock(mutex);
+        published = true;
+        cv.notify_one();
+    });
+
+    // frames which are in the output already. partial images are never there, as they are renamed
+    // only when written, and a partial frame of the video is cut off
+    const size_t frameBytes = 3 * static_cast<size_t>(size.width()) * size.height();
+    std::vector<bool> done(count);
+    std::FILE* video = nullptr;
+    if (raw) {
+        std::error_code error;
+        uintmax_t bytes = std::filesystem::file_size(output, error);
+        size_t written = error ? 0 : std::min<size_t>(count, bytes / frameBytes);
+        if (!error) {
+            std::filesystem::resize_file(output, written * frameBytes, error);
+        }
+        std::fill(done.begin(), done.begin() + written, true);
+        video = std::fopen(output.c_str(), "ab");
+        if (video == nullptr) {
+            return "can't open " + output + ": " + std::strerror(errno);
+        }
+    } else {
+        for (size_t frame = 0; frame < count; ++frame) {
+            frameName(output, frame, name);
+            done[frame] = std::filesystem::exists(name);
+        }
+    }
+
+    // consecutive frames of the same key frame, only the ones with something left to render
+    struct Group {
+        int64_t key;
+        size_t first, last;
+    };
+    std::vector<Group> groups;
+    for (size_t frame = 0; frame < count; ++frame) {
+        if (groups.empty() || groups.back().key != keyOf(frame)) {
+            groups.push_back({keyOf(frame), frame, frame});
+        }
+        groups.back().last = frame;
+    }
+    groups.erase(std::remove_if(groups.begin(), groups.end(), [&](Group const& group) {
+        return std::all_of(done.begin() + group.first, done.begin() + group.last + 1, [](bool value) {
+            return value;
+        });
+    }), groups.end());
+
+    // halved pixels are on the grid of the previous ones when their centers are half a pixel off the point.
+    // then the engine doesn't move the key frames, and a restarted run renders the same ones
+    const size_t precision = center.precision();
+    auto requestKey = [&](size_t index) {
+        const FloatExp keyScale = deeper(from, groups[index].key + 1);
+        const BigFixed half(keyScale * 0.5, precision);
+        engine.request(index + 1, center + BigPos(half, half), Size(2 * size.width(), 2 * size.height()),
+                       keyScale, scaleLogOf(keyScale), false);
+    };
+
+    WorkerPool pool(engine.getSettings().threadsCount);
+    FrameExchange& frames = engine.frames(false);
+    Image image(size);
+    std::vector<unsigned char> row(3 * size.width());
+    std::string error;
+    size_t rendered = 0;
+    size_t keyFrames = 0;
+
+    if (!groups.empty()) {
+        requestKey(0);
+    }
+    for (size_t index = 0; index < groups.size() && error.empty(); ++index) {
+        // the progressive stages are skipped, so every delivered frame is the complete key frame
+        for (;;) {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&] { return published; });
+            published = false;
+            lock.unlock();
+
+            if (frames.take() && frames.info().complete && frames.info().frameSeqId == index + 1) {
+                break;
+            }
+        }
+        ++keyFrames;
+
+        // the taken key frame is kept until the next take, so the next one is rendered meanwhile
+        if (index + 1 < groups.size()) {
+            requestKey(index + 1);
+        }
+
+        Group const& group = groups[index];
+        for (size_t frame = group.first; frame <= group.last && error.empty(); ++frame) {
+            if (done[frame]) {
+                continue;
+            }
+
+            // frame pixel is from one to two key pixels
+            const double ratio = std::exp2(group.key + 1 - frameDepth(frame));
+            resample(frames.image(), frames.info().offset + Pos(0.5, 0.5), ratio, image, pool);
+
+            if (raw) {
+                for (int y = 0; y < image.height() && error.empty(); ++y) {
+                    Rgb const* pixels = image.scanLine(y);
+                    for (int x = 0; x < image.width(); ++x) {
+                        row[3 * x] = red(pixels[x]);
+                        row[3 * x + 1] = green(pixels[x]);
+                        row[3 * x + 2] = blue(pixels[x]);
+                    }
+                    if (std::fwrite(row.data(), 1, row.size(), video) != row.size()) {
+                        error = "can't write " + output + ": " + std::strerror(errno);
+                    }
+                }
+            } else {
+                frameName(output, frame, name);
+                const std::string partial = name + ".part";
+                std::unique_ptr<ImageWriter> writer = ImageWriter::create(name);
+                if (!writer->open(partial, size) || !writer->write(image, pool) || !writer->close()
+                        || std::rename(partial.c_str(), name.c_str()) != 0) {
+                    error = "can't write " + name + ": " + std::strerror(errno);
+                    std::remove(partial.c_str());
+                }
+            }
+
+            ++rendered;
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            if (progressCallback && error.empty()) {
+                progressCallback(frame + 1, count, rendered / elapsed.count());
+            }
+        }
+    }
+    engine.stop();
+    engine.wait();
+
+    if (video != nullptr && std::fclose(video) != 0 && error.empty()) {
+        error = "can't write " + output + ": " + std::strerror(errno);
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    debug()
+            << "zoom " << rendered << " frames of " << count << " from " << keyFrames << " key frames: "
+            << elapsed.count() << " s, " << rendered / elapsed.count() << " fps";
+    return error;
+}
+
+}